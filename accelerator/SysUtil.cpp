@@ -33,6 +33,15 @@ bool setCpuAffinity(int cpu, pid_t pid) {
   return sched_setaffinity(pid, sizeof(mask), &mask) == 0;
 }
 
+bool setCpuAffinity(const std::vector<int>& cpus, pid_t pid) {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &mask);
+  }
+  return sched_setaffinity(pid, sizeof(mask), &mask) == 0;
+}
+
 int getCpuAffinity(pid_t pid) {
   cpu_set_t mask;
   CPU_ZERO(&mask);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <unistd.h>
 #include <sys/statvfs.h>
 #include <sys/sysinfo.h>
@@ -28,6 +29,7 @@ inline int getCpuNum() {
 }
 
 bool setCpuAffinity(int cpu, pid_t pid = 0);
+bool setCpuAffinity(const std::vector<int>& cpus, pid_t pid = 0);
 int getCpuAffinity(pid_t pid = 0);
 
 struct StatVFS {
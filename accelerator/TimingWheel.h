@@ -0,0 +1,224 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "accelerator/Time.h"
+
+namespace acc {
+
+/**
+ * Intrusive hook of TimingWheel, embed it in the timed object.
+ *
+ * Usage:
+ *
+ * class MyClass {
+ *   TimingWheelHook<MyClass> hook;
+ * }
+ *
+ * TimingWheel<MyClass, &MyClass::hook> wheel;
+ * wheel.push(Timeout<MyClass>(&a, deadline));
+ * while ((t = wheel.pop(now)).data) { ... }
+ */
+template <class T>
+struct TimingWheelHook {
+  TimingWheelHook* prev{nullptr};
+  TimingWheelHook* next{nullptr};
+  T* data{nullptr};
+  uint64_t deadline{0};
+  bool repeat{false};
+
+  bool isLinked() const {
+    return next != nullptr;
+  }
+
+  void unlink() {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = nullptr;
+  }
+};
+
+/**
+ * Hierarchical timing wheel with the same interface as TimedHeap.
+ *
+ * 4 levels of 256 slots, each slot is a circular doubly-linked list of
+ * hooks, so push, erase and re-push are O(1) without any map lookup.
+ * Timers on higher levels are cascaded down when the lower level wraps.
+ * Deadlines beyond the range of the wheel (2^32 ticks) are clamped to
+ * the last slot and re-cascaded until they expire.
+ *
+ * Timers expiring in the same tick are popped in insertion order.
+ */
+template <class T, TimingWheelHook<T> T::*HookMember>
+class TimingWheel {
+ public:
+  typedef TimingWheelHook<T> Hook;
+
+  static constexpr int kLevelBits = 8;
+  static constexpr int kLevels = 4;
+  static constexpr size_t kSlots = 1 << kLevelBits;
+  static constexpr uint64_t kSlotMask = kSlots - 1;
+
+  explicit TimingWheel(uint64_t tick = 1000 /* 1ms */,
+                       uint64_t now = timestampNow())
+    : tick_(tick), current_(now / tick) {
+    for (auto& level : wheel_) {
+      for (auto& slot : level) {
+        slot.prev = slot.next = &slot;
+      }
+    }
+  }
+
+  // The linked objects may be gone already, so their hooks are left
+  // untouched, only the slot heads are reset.
+  ~TimingWheel() {
+    for (auto& level : wheel_) {
+      for (auto& slot : level) {
+        slot.prev = slot.next = &slot;
+      }
+    }
+    size_ = 0;
+  }
+
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void push(Timeout<T> v) {
+    if (!v.data) {
+      return;
+    }
+    Hook* h = &(v.data->*HookMember);
+    if (h->isLinked()) {
+      h->unlink();
+      size_--;
+    }
+    h->data = v.data;
+    h->deadline = v.deadline;
+    h->repeat = v.repeat;
+    link(h);
+    size_++;
+  }
+
+  Timeout<T> pop(uint64_t now) {
+    uint64_t target = now / tick_;
+    if (size_ == 0) {
+      if (target > current_) {
+        current_ = target;
+      }
+      return Timeout<T>();
+    }
+    while (true) {
+      Hook* slot = &wheel_[0][current_ & kSlotMask];
+      for (Hook* h = slot->next; h != slot; h = h->next) {
+        if (h->deadline <= now) {
+          h->unlink();
+          size_--;
+          return Timeout<T>(h->data, h->deadline, h->repeat);
+        }
+      }
+      if (current_ >= target) {
+        break;
+      }
+      current_++;
+      cascade();
+    }
+    return Timeout<T>();
+  }
+
+  void erase(T* k) {
+    if (!k) {
+      return;
+    }
+    Hook* h = &(k->*HookMember);
+    if (h->isLinked()) {
+      h->unlink();
+      size_--;
+    }
+  }
+
+  void clear() {
+    for (auto& level : wheel_) {
+      for (auto& slot : level) {
+        while (slot.next != &slot) {
+          slot.next->unlink();
+        }
+      }
+    }
+    size_ = 0;
+  }
+
+ private:
+  static size_t index(uint64_t tick, int level) {
+    return (tick >> (level * kLevelBits)) & kSlotMask;
+  }
+
+  void link(Hook* h) {
+    uint64_t expire = h->deadline / tick_;
+    if (expire < current_) {
+      expire = current_;
+    }
+    uint64_t delta = expire - current_;
+    int level = 0;
+    while (level < kLevels - 1 && delta >> ((level + 1) * kLevelBits)) {
+      level++;
+    }
+    if (delta >> (kLevels * kLevelBits)) {
+      expire = current_ + (uint64_t(1) << (kLevels * kLevelBits)) - 1;
+    }
+    Hook* slot = &wheel_[level][index(expire, level)];
+    h->prev = slot->prev;
+    h->next = slot;
+    slot->prev->next = h;
+    slot->prev = h;
+  }
+
+  // Moves timers of the higher level slot matching current_ down, must be
+  // called every time current_ is advanced.
+  void cascade() {
+    for (int level = 1; level < kLevels; level++) {
+      if (index(current_, level - 1) != 0) {
+        break;
+      }
+      Hook* slot = &wheel_[level][index(current_, level)];
+      Hook* h = slot->next;
+      slot->prev = slot->next = slot;
+      while (h != slot) {
+        Hook* next = h->next;
+        link(h);
+        h = next;
+      }
+    }
+  }
+
+  uint64_t tick_;
+  uint64_t current_;
+  size_t size_{0};
+  Hook wheel_[kLevels][kSlots];
+};
+
+} // namespace acc
@@ -0,0 +1,18 @@
+#pragma once
+
+/* meta */
+
+#define ACC_PACKAGE "accelerator"
+#define ACC_VERSION "1.2.4"
+
+/* compile tests for keyword, lib, function, ... */
+
+/* #undef ACC_HAVE_XSI_STRERROR_R */
+
+/* gflags */
+
+#define ACC_GFLAGS_NAMESPACE gflags
+/* #undef ACC_UNUSUAL_GFLAGS_NAMESPACE */
+
+/* monitor */
+#define ACC_MON_ENABLE 1
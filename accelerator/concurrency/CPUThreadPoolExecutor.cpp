@@ -18,11 +18,21 @@
 #include "accelerator/concurrency/CPUThreadPoolExecutor.h"
 
 #include "accelerator/thread/BlockingQueue.h"
+#include "accelerator/thread/SpinLock.h"
 
 namespace acc {
 
 const size_t CPUThreadPoolExecutor::kDefaultMaxQueueSize = 1 << 14;
 
+namespace {
+
+bool isExpired(const CPUThreadPoolExecutor::CPUTask& task) {
+  return task.expiration_ > 0 &&
+    timePassed(task.enqueueTime_) >= task.expiration_;
+}
+
+} // namespace
+
 CPUThreadPoolExecutor::CPUThreadPoolExecutor(
     size_t numThreads,
     std::unique_ptr<BlockingQueue<CPUTask>> taskQueue,
@@ -64,9 +74,103 @@ void CPUThreadPoolExecutor::add(
     VoidFunc func,
     uint64_t expiration,
     VoidFunc expireCallback) {
-  // TODO handle enqueue failure, here and in other add() callsites
-  taskQueue_->add(
-      CPUTask(std::move(func), expiration, std::move(expireCallback)));
+  addTask(CPUTask(std::move(func), expiration, std::move(expireCallback)));
+}
+
+bool CPUThreadPoolExecutor::tryAdd(
+    VoidFunc func,
+    uint64_t expiration,
+    VoidFunc expireCallback) {
+  if (!taskQueue_->tryAdd(
+          CPUTask(std::move(func), expiration, std::move(expireCallback)))) {
+    return false;
+  }
+  updateMaxPendingTasks(taskQueue_->size());
+  return true;
+}
+
+void CPUThreadPoolExecutor::addBatch(std::vector<VoidFunc> funcs) {
+  std::vector<CPUTask> tasks;
+  tasks.reserve(funcs.size());
+  for (auto& func : funcs) {
+    tasks.emplace_back(std::move(func), 0, nullptr);
+  }
+  size_t n = taskQueue_->addBatch(tasks);
+  updateMaxPendingTasks(taskQueue_->size());
+  for (; n < tasks.size(); n++) {
+    addTask(std::move(tasks[n]));
+  }
+}
+
+void CPUThreadPoolExecutor::addWithPriority(VoidFunc func, int8_t priority) {
+  add(std::move(func), priority, 0, nullptr);
+}
+
+void CPUThreadPoolExecutor::add(
+    VoidFunc func,
+    int8_t priority,
+    uint64_t expiration,
+    VoidFunc expireCallback) {
+  addTask(CPUTask(std::move(func), priority, expiration,
+                  std::move(expireCallback)));
+}
+
+uint8_t CPUThreadPoolExecutor::getNumPriorities() const {
+  return taskQueue_->getNumPriorities();
+}
+
+void CPUThreadPoolExecutor::addTask(CPUTask&& task) {
+  if (UNLIKELY(!taskQueue_->tryAdd(std::move(task)))) {
+    overflow(std::move(task));
+    return;
+  }
+  updateMaxPendingTasks(taskQueue_->size());
+}
+
+void CPUThreadPoolExecutor::overflow(CPUTask&& task) {
+  switch (getOverflowPolicy()) {
+    case kThrow:
+      throw std::runtime_error("CPUThreadPoolExecutor queue full");
+    case kReject:
+      break;
+    case kBlock: {
+      uint64_t timeout = blockTimeout_.load(std::memory_order_relaxed);
+      uint64_t start = timestampNow();
+      detail::Sleeper sleeper;
+      while (timeout == 0 || timePassed(start) < timeout) {
+        if (taskQueue_->tryAdd(std::move(task))) {
+          return;
+        }
+        sleeper.wait();
+      }
+      break;
+    }
+    case kCallerRuns:
+      runTaskInline(std::move(task));
+      return;
+    case kDropOldestExpired: {
+      // only ever takes expired tasks, the others stay in order
+      auto expired = [](const CPUTask& t) {
+        return !t.poison && isExpired(t);
+      };
+      CPUTask oldest;
+      while (taskQueue_->tryTakeIf(expired, oldest)) {
+        runTaskInline(std::move(oldest));
+        if (taskQueue_->tryAdd(std::move(task))) {
+          return;
+        }
+      }
+      break;
+    }
+  }
+  reject(std::move(task));
+}
+
+void CPUThreadPoolExecutor::reject(CPUTask&& task) {
+  rejectedTasks_++;
+  if (rejectCallback_) {
+    rejectCallback_(std::move(task.func_));
+  }
 }
 
 void CPUThreadPoolExecutor::threadRun(std::shared_ptr<Thread> thread) {
@@ -102,7 +206,11 @@ void CPUThreadPoolExecutor::threadRun(std::shared_ptr<Thread> thread) {
 void CPUThreadPoolExecutor::stopThreads(size_t n) {
   threadsToStop_ += n;
   for (size_t i = 0; i < n; i++) {
-    taskQueue_->add(CPUTask());
+    // waits for room, the threads left keep draining the queue
+    detail::Sleeper sleeper;
+    while (!taskQueue_->tryAdd(CPUTask())) {
+      sleeper.wait();
+    }
   }
 }
 
@@ -24,9 +24,9 @@ namespace acc {
 /**
  * A Thread pool for CPU bound tasks.
  *
- * @note The default queue throws when full, so add() can fail.
- * Furthermore, join() can also fail if the queue is full,
- * because it enqueues numThreads poison tasks to stop the threads.
+ * @note The default queue is bounded, add() applies the overflow policy
+ * when it is full, throwing by default. join() waits for room in a full
+ * queue, because it enqueues numThreads poison tasks to stop the threads.
  *
  * @note stop() will finish all outstanding tasks at exit.
  */
@@ -34,6 +34,27 @@ class CPUThreadPoolExecutor : public ThreadPoolExecutor {
  public:
   struct CPUTask;
 
+  /**
+   * What add() does when the task queue is full.
+   */
+  enum OverflowPolicy {
+    // throws std::runtime_error
+    kThrow,
+    // passes the func to the reject callback, if any
+    kReject,
+    // retries until the block timeout (0 for no timeout), then rejects
+    kBlock,
+    // runs the func on the calling thread, or expires it, as a pool
+    // thread would
+    kCallerRuns,
+    // expires the oldest tasks which waited past their expiration to make
+    // room, then rejects; needs a queue with tryTakeIf(), such as the
+    // default MPMC one or DeadlineTaskQueue, else only rejects
+    kDropOldestExpired,
+  };
+
+  typedef std::function<void(VoidFunc)> RejectCallback;
+
   CPUThreadPoolExecutor(
       size_t numThreads,
       std::unique_ptr<BlockingQueue<CPUTask>> taskQueue,
@@ -58,8 +79,38 @@ class CPUThreadPoolExecutor : public ThreadPoolExecutor {
            uint64_t expiration,
            VoidFunc expireCallback = nullptr) override;
 
+  // adds unless the queue is full, regardless of the overflow policy
+  bool tryAdd(VoidFunc func,
+              uint64_t expiration = 0,
+              VoidFunc expireCallback = nullptr);
+
+  void addBatch(std::vector<VoidFunc> funcs) override;
+
+  // Needs a task queue with priorities, such as PriorityTaskQueue.
+  void addWithPriority(VoidFunc func, int8_t priority) override;
+  void add(VoidFunc func,
+           int8_t priority,
+           uint64_t expiration,
+           VoidFunc expireCallback);
+
+  uint8_t getNumPriorities() const override;
+
   uint64_t getPendingTaskCount() override;
 
+  void setOverflowPolicy(OverflowPolicy policy, uint64_t blockTimeout = 0) {
+    blockTimeout_.store(blockTimeout, std::memory_order_relaxed);
+    overflowPolicy_.store(policy, std::memory_order_relaxed);
+  }
+
+  OverflowPolicy getOverflowPolicy() const {
+    return overflowPolicy_.load(std::memory_order_relaxed);
+  }
+
+  // Set before adding tasks.
+  void setRejectCallback(RejectCallback callback) {
+    rejectCallback_ = std::move(callback);
+  }
+
   struct CPUTask : public ThreadPoolExecutor::Task {
     // Must be noexcept move constructible so it can be used in MPMCQueue
 
@@ -69,6 +120,14 @@ class CPUThreadPoolExecutor : public ThreadPoolExecutor {
         VoidFunc&& expireCallback)
         : Task(std::move(f), expiration, std::move(expireCallback)),
           poison(false) {}
+    explicit CPUTask(
+        VoidFunc&& f,
+        int8_t priority,
+        uint64_t expiration,
+        VoidFunc&& expireCallback)
+        : CPUTask(std::move(f), expiration, std::move(expireCallback)) {
+      stats_.priority = priority;
+    }
     CPUTask()
         : Task(nullptr, 0, nullptr), poison(true) {}
 
@@ -81,7 +140,14 @@ class CPUThreadPoolExecutor : public ThreadPoolExecutor {
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
 
+  void addTask(CPUTask&& task);
+  void overflow(CPUTask&& task);
+  void reject(CPUTask&& task);
+
   std::unique_ptr<BlockingQueue<CPUTask>> taskQueue_;
+  std::atomic<OverflowPolicy> overflowPolicy_{kThrow};
+  std::atomic<uint64_t> blockTimeout_{0};
+  RejectCallback rejectCallback_;
   std::atomic<ssize_t> threadsToStop_{0};
 };
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/DeadlineTaskQueue.h"
+
+#include <algorithm>
+
+#include "accelerator/Time.h"
+
+namespace acc {
+
+DeadlineTaskQueue::DeadlineTaskQueue(
+    uint64_t defaultSlack,
+    uint64_t hopelessMargin,
+    size_t maxQueueSize)
+  : defaultSlack_(defaultSlack),
+    hopelessMargin_(hopelessMargin),
+    maxQueueSize_(maxQueueSize) {}
+
+void DeadlineTaskQueue::add(CPUTask item) {
+  if (!tryAdd(std::move(item))) {
+    throw std::runtime_error("DeadlineTaskQueue full, can't add item");
+  }
+}
+
+bool DeadlineTaskQueue::tryAdd(CPUTask&& item) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!item.poison && maxQueueSize_ > 0 && heap_.size() >= maxQueueSize_) {
+      return false;
+    }
+    push(std::move(item));
+  }
+  sem_.post();
+  return true;
+}
+
+size_t DeadlineTaskQueue::addBatch(std::vector<CPUTask>& items) {
+  size_t n = 0;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (auto& item : items) {
+      if (!item.poison && maxQueueSize_ > 0 && heap_.size() >= maxQueueSize_) {
+        break;
+      }
+      push(std::move(item));
+      n++;
+    }
+  }
+  sem_.post(n);
+  return n;
+}
+
+void DeadlineTaskQueue::push(CPUTask&& item) {
+  if (item.poison) {
+    poisons_++;
+    return;
+  }
+  uint64_t slack = item.expiration_ > 0 ? item.expiration_ : defaultSlack_;
+  heap_.push_back(Entry{item.enqueueTime_ + slack, seq_++, std::move(item)});
+  std::push_heap(heap_.begin(), heap_.end());
+}
+
+DeadlineTaskQueue::CPUTask DeadlineTaskQueue::pop() {
+  std::pop_heap(heap_.begin(), heap_.end());
+  Entry entry = std::move(heap_.back());
+  heap_.pop_back();
+  // runTask() expires it without running
+  if (entry.task.expiration_ > 0 &&
+      timestampNow() + hopelessMargin_ >= entry.deadline) {
+    entry.task.stats_.expired = true;
+  }
+  return std::move(entry.task);
+}
+
+DeadlineTaskQueue::CPUTask DeadlineTaskQueue::take() {
+  // each permit matches one added task or poison
+  sem_.wait();
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!heap_.empty()) {
+    return pop();
+  }
+  poisons_--;
+  return CPUTask();
+}
+
+bool DeadlineTaskQueue::tryTake(CPUTask& item) {
+  // keep a permit per item for take()
+  if (!sem_.tryWait()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  if (heap_.empty()) {
+    // the permit is of a poison
+    sem_.post();
+    return false;
+  }
+  item = pop();
+  return true;
+}
+
+bool DeadlineTaskQueue::tryTakeIf(
+    const std::function<bool(const CPUTask&)>& pred,
+    CPUTask& item) {
+  if (!sem_.tryWait()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  if (heap_.empty() || !pred(heap_.front().task)) {
+    sem_.post();
+    return false;
+  }
+  item = pop();
+  return true;
+}
+
+size_t DeadlineTaskQueue::size() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return heap_.size();
+}
+
+} // namespace acc
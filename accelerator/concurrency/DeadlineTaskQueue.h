@@ -0,0 +1,96 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/thread/BlockingQueue.h"
+#include "accelerator/thread/LifoSem.h"
+
+namespace acc {
+
+/**
+ * Task queue of CPUThreadPoolExecutor taking tasks earliest deadline
+ * first (EDF), where the deadline of a task is its enqueue time plus its
+ * expiration. Tasks without expiration get the defaultSlack instead, so
+ * they are served FIFO among themselves and are not starved by a steady
+ * stream of tight tasks.
+ *
+ * A task taken when it cannot finish in time any more, that is less than
+ * hopelessMargin (the expected run time) before its deadline, is expired
+ * at once instead of running late and delaying the tasks behind it.
+ *
+ * Poison tasks of stopping threads are only taken when no task is left,
+ * so stop() still runs all outstanding tasks.
+ *
+ * Usage:
+ *
+ *   CPUThreadPoolExecutor pool(n, make_unique<DeadlineTaskQueue>());
+ *   pool.add(func, 500, expireCallback);  // due in 500us
+ */
+class DeadlineTaskQueue
+    : public BlockingQueue<CPUThreadPoolExecutor::CPUTask> {
+ public:
+  typedef CPUThreadPoolExecutor::CPUTask CPUTask;
+
+  explicit DeadlineTaskQueue(
+      uint64_t defaultSlack = 1000000 /* 1s */,
+      uint64_t hopelessMargin = 0,
+      size_t maxQueueSize = 0 /* unbounded */);
+
+  void add(CPUTask item) override;
+  bool tryAdd(CPUTask&& item) override;
+  size_t addBatch(std::vector<CPUTask>& items) override;
+  CPUTask take() override;
+  // takes the task of the earliest deadline
+  bool tryTake(CPUTask& item) override;
+  // takes the task of the earliest deadline if pred holds for it
+  bool tryTakeIf(const std::function<bool(const CPUTask&)>& pred,
+                 CPUTask& item) override;
+  size_t size() override;
+
+ private:
+  struct Entry {
+    uint64_t deadline;
+    uint64_t seq;
+    CPUTask task;
+
+    // reversed for a min-heap
+    bool operator<(const Entry& other) const {
+      return deadline != other.deadline
+        ? deadline > other.deadline
+        : seq > other.seq;
+    }
+  };
+
+  // Prerequisite: lock_ held
+  void push(CPUTask&& item);
+  CPUTask pop();
+
+  const uint64_t defaultSlack_;
+  const uint64_t hopelessMargin_;
+  const size_t maxQueueSize_;
+  std::vector<Entry> heap_;
+  uint64_t seq_{0};
+  size_t poisons_{0};
+  std::mutex lock_;
+  LifoSem sem_;
+};
+
+} // namespace acc
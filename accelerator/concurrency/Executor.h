@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <climits>
+#include <cstdint>
+#include <vector>
+
 #include "accelerator/Function.h"
 
 namespace acc {
@@ -27,6 +31,33 @@ class Executor {
  public:
   virtual ~Executor() {}
   virtual void add(VoidFunc) = 0;
+
+  /**
+   * Adds all funcs at once, executors override it to enqueue them
+   * together and wake only the workers needed.
+   */
+  virtual void addBatch(std::vector<VoidFunc> funcs) {
+    for (auto& func : funcs) {
+      add(std::move(func));
+    }
+  }
+
+  static const int8_t LO_PRI  = SCHAR_MIN;
+  static const int8_t MID_PRI = 0;
+  static const int8_t HI_PRI  = SCHAR_MAX;
+
+  /**
+   * Priorities are mapped onto the getNumPriorities() lanes of the
+   * executor, MID_PRI on the middle one. Executors without priorities
+   * ignore them.
+   */
+  virtual void addWithPriority(VoidFunc func, int8_t /* priority */) {
+    add(std::move(func));
+  }
+
+  virtual uint8_t getNumPriorities() const {
+    return 1;
+  }
 };
 
 } // namespace acc
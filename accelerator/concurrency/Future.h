@@ -0,0 +1,492 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "accelerator/Logging.h"
+#include "accelerator/MoveWrapper.h"
+#include "accelerator/Optional.h"
+#include "accelerator/concurrency/Executor.h"
+#include "accelerator/event/EventLoop.h"
+#include "accelerator/thread/Baton.h"
+
+namespace acc {
+
+// value of futures without one, such as a continuation returning void
+struct Unit {};
+
+class FutureException : public std::runtime_error {
+ public:
+  explicit FutureException(const std::string& what)
+    : std::runtime_error(what) {}
+};
+
+// of the future of a promise destroyed before it was fulfilled
+class BrokenPromise : public FutureException {
+ public:
+  BrokenPromise() : FutureException("broken promise") {}
+};
+
+// of the future of within() when the timeout passed first
+class FutureTimeout : public FutureException {
+ public:
+  FutureTimeout() : FutureException("future timed out") {}
+};
+
+/**
+ * A value or an exception.
+ */
+template <class T>
+class Try {
+ public:
+  Try() {}
+  explicit Try(T&& value) : value_(std::move(value)) {}
+  explicit Try(const T& value) : value_(value) {}
+  explicit Try(std::exception_ptr e) : exception_(std::move(e)) {}
+
+  bool hasValue() const {
+    return value_.hasValue();
+  }
+
+  bool hasException() const {
+    return exception_ != nullptr;
+  }
+
+  // rethrows the exception, if any
+  T& value() {
+    throwIfFailed();
+    return value_.value();
+  }
+  const T& value() const {
+    throwIfFailed();
+    return value_.value();
+  }
+
+  const std::exception_ptr& exception() const {
+    return exception_;
+  }
+
+  void throwIfFailed() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+ private:
+  Optional<T> value_;
+  std::exception_ptr exception_;
+};
+
+template <class T> class Future;
+template <class T> class Promise;
+
+namespace detail {
+
+// Calls f with the value of t, an exception of t or thrown by f is kept
+// in the result, and void results are lifted to Unit.
+template <class R>
+struct TryCall {
+  typedef R Result;
+
+  template <class F, class T>
+  static Try<R> call(F& f, Try<T>&& t) {
+    if (t.hasException()) {
+      return Try<R>(t.exception());
+    }
+    try {
+      return Try<R>(f(std::move(t.value())));
+    } catch (...) {
+      return Try<R>(std::current_exception());
+    }
+  }
+};
+
+template <>
+struct TryCall<void> {
+  typedef Unit Result;
+
+  template <class F, class T>
+  static Try<Unit> call(F& f, Try<T>&& t) {
+    if (t.hasException()) {
+      return Try<Unit>(t.exception());
+    }
+    try {
+      f(std::move(t.value()));
+      return Try<Unit>(Unit());
+    } catch (...) {
+      return Try<Unit>(std::current_exception());
+    }
+  }
+};
+
+template <class F, class T>
+struct ContinuationOf {
+  typedef TryCall<typename std::decay<typename std::result_of<
+    typename std::decay<F>::type(T&&)>::type>::type> Call;
+  typedef typename Call::Result Result;
+};
+
+// State shared by a promise and its future, holding either the result
+// or the continuation, whichever comes first.
+template <class T>
+class FutureState {
+ public:
+  typedef std::function<void(Try<T>&&)> Callback;
+
+  void setResult(Try<T>&& result) {
+    Callback callback;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      ACCCHECK(!ready_) << "result already set";
+      ready_ = true;
+      if (!callback_) {
+        result_ = std::move(result);
+        return;
+      }
+      callback.swap(callback_);
+    }
+    callback(std::move(result));
+  }
+
+  void setCallback(Callback&& callback) {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      if (!ready_) {
+        callback_ = std::move(callback);
+        return;
+      }
+    }
+    callback(std::move(result_));
+  }
+
+  bool isReady() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return ready_;
+  }
+
+  // takes the result if ready
+  bool tryTake(Try<T>& result) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!ready_) {
+      return false;
+    }
+    result = std::move(result_);
+    return true;
+  }
+
+ private:
+  std::mutex lock_;
+  bool ready_{false};
+  Try<T> result_;
+  Callback callback_;
+};
+
+} // namespace detail
+
+/**
+ * The result of an asynchronous operation, set by a Promise.
+ *
+ * Continuations attached by then() run inline, on the thread setting
+ * the result or at once if the result is ready, while then(executor, f)
+ * adds them to the executor. A future is consumed by then(), get() and
+ * the other operations taking its result.
+ *
+ * A ready future, from makeFuture() or a then() on a ready future, keeps
+ * its result inline, so inline continuations of ready values allocate
+ * nothing.
+ *
+ * Usage:
+ *
+ *   Promise<int> promise;
+ *   auto future = promise.getFuture()
+ *     .then(&pool, [](int v) { return v * 2; })
+ *     .then([](int v) { ACCLOG(INFO) << v; })
+ *     .within(loop, 1000000);
+ *   promise.setValue(21);
+ */
+template <class T>
+class Future {
+ public:
+  typedef T value_type;
+
+  Future() {}
+
+  explicit Future(Try<T>&& result) : result_(std::move(result)) {}
+
+  Future(Future&&) = default;
+  Future& operator=(Future&&) = default;
+
+  bool valid() const {
+    return result_.hasValue() || state_ != nullptr;
+  }
+
+  bool isReady() const {
+    return result_.hasValue() || (state_ && state_->isReady());
+  }
+
+  // Blocks until ready.
+  Try<T> getTry() {
+    if (!result_ && !takeReady()) {
+      Baton baton;
+      Try<T> result;
+      state_->setCallback([&](Try<T>&& t) {
+        result = std::move(t);
+        baton.post();
+      });
+      state_.reset();
+      baton.wait();
+      return result;
+    }
+    return takeResult();
+  }
+
+  // Blocks until ready, rethrows the exception, if any.
+  T get() {
+    return std::move(getTry().value());
+  }
+
+  // Calls f with the result once ready, on the thread setting it, or at
+  // once if ready.
+  template <class F>
+  void setCallback(F&& f) {
+    if (result_ || takeReady()) {
+      f(takeResult());
+      return;
+    }
+    state_->setCallback(
+        typename detail::FutureState<T>::Callback(std::forward<F>(f)));
+    state_.reset();
+  }
+
+  // Continues with f(value) inline, an exception skips f.
+  template <class F,
+            class C = typename detail::ContinuationOf<F, T>::Call,
+            class R = typename detail::ContinuationOf<F, T>::Result>
+  Future<R> then(F&& f) {
+    if (result_ || takeReady()) {
+      return Future<R>(C::call(f, takeResult()));
+    }
+    auto state = std::make_shared<detail::FutureState<R>>();
+    auto fw = makeMoveWrapper(typename std::decay<F>::type(
+        std::forward<F>(f)));
+    setCallback([state, fw](Try<T>&& t) mutable {
+      state->setResult(C::call(*fw, std::move(t)));
+    });
+    return Future<R>(std::move(state));
+  }
+
+  // Continues with f(value) added to executor, an exception skips f.
+  template <class F,
+            class C = typename detail::ContinuationOf<F, T>::Call,
+            class R = typename detail::ContinuationOf<F, T>::Result>
+  Future<R> then(Executor* executor, F&& f) {
+    auto state = std::make_shared<detail::FutureState<R>>();
+    auto fw = makeMoveWrapper(typename std::decay<F>::type(
+        std::forward<F>(f)));
+    setCallback([executor, state, fw](Try<T>&& t) mutable {
+      auto tw = makeMoveWrapper(std::move(t));
+      executor->add([state, fw, tw]() mutable {
+        state->setResult(C::call(*fw, tw.move()));
+      });
+    });
+    return Future<R>(std::move(state));
+  }
+
+  // Fails with FutureTimeout unless ready within timeout (us), timed by
+  // a timer of loop.
+  Future<T> within(EventLoop* loop, uint64_t timeout) {
+    if (isReady()) {
+      return std::move(*this);
+    }
+    struct Context {
+      std::atomic<bool> done{false};
+      Promise<T> promise;
+    };
+    auto ctx = std::make_shared<Context>();
+    auto future = ctx->promise.getFuture();
+    loop->runAfter(timeout, [ctx]() {
+      if (!ctx->done.exchange(true)) {
+        ctx->promise.setException(std::make_exception_ptr(FutureTimeout()));
+      }
+    });
+    setCallback([ctx](Try<T>&& t) {
+      if (!ctx->done.exchange(true)) {
+        ctx->promise.setTry(std::move(t));
+      }
+    });
+    return future;
+  }
+
+ private:
+  template <class U> friend class Future;
+  friend class Promise<T>;
+
+  explicit Future(std::shared_ptr<detail::FutureState<T>> state)
+    : state_(std::move(state)) {}
+
+  bool takeReady() {
+    ACCCHECK(state_) << "future already consumed";
+    Try<T> result;
+    if (!state_->tryTake(result)) {
+      return false;
+    }
+    result_ = std::move(result);
+    state_.reset();
+    return true;
+  }
+
+  Try<T> takeResult() {
+    Try<T> result = std::move(result_.value());
+    result_.clear();
+    return result;
+  }
+
+  // the result of a ready future, or the state shared with the promise
+  Optional<Try<T>> result_;
+  std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+/**
+ * Sets the result of its Future, once. A promise destroyed unfulfilled
+ * fails its future with BrokenPromise.
+ */
+template <class T>
+class Promise {
+ public:
+  Promise() : state_(std::make_shared<detail::FutureState<T>>()) {}
+
+  ~Promise() {
+    if (state_ && !fulfilled_) {
+      setException(std::make_exception_ptr(BrokenPromise()));
+    }
+  }
+
+  Promise(Promise&& other) noexcept
+    : state_(std::move(other.state_)),
+      retrieved_(other.retrieved_),
+      fulfilled_(other.fulfilled_) {}
+
+  Promise& operator=(Promise&&) = delete;
+
+  Future<T> getFuture() {
+    ACCCHECK(!retrieved_) << "future already retrieved";
+    retrieved_ = true;
+    return Future<T>(state_);
+  }
+
+  bool isFulfilled() const {
+    return fulfilled_;
+  }
+
+  void setTry(Try<T>&& result) {
+    ACCCHECK(!fulfilled_) << "promise already fulfilled";
+    fulfilled_ = true;
+    state_->setResult(std::move(result));
+  }
+
+  void setValue(T value) {
+    setTry(Try<T>(std::move(value)));
+  }
+
+  void setException(std::exception_ptr e) {
+    setTry(Try<T>(std::move(e)));
+  }
+
+ private:
+  std::shared_ptr<detail::FutureState<T>> state_;
+  bool retrieved_{false};
+  bool fulfilled_{false};
+};
+
+template <class T>
+Future<typename std::decay<T>::type> makeFuture(T&& value) {
+  typedef typename std::decay<T>::type V;
+  return Future<V>(Try<V>(std::forward<T>(value)));
+}
+
+inline Future<Unit> makeFuture() {
+  return makeFuture(Unit());
+}
+
+template <class T>
+Future<T> makeFuture(std::exception_ptr e) {
+  return Future<T>(Try<T>(std::move(e)));
+}
+
+/**
+ * Completes when all futures are, with their results in order.
+ */
+template <class T>
+Future<std::vector<Try<T>>> collectAll(std::vector<Future<T>> futures) {
+  if (futures.empty()) {
+    return makeFuture(std::vector<Try<T>>());
+  }
+  struct Context {
+    explicit Context(size_t n) : results(n), remaining(n) {}
+    std::vector<Try<T>> results;
+    std::atomic<size_t> remaining;
+    Promise<std::vector<Try<T>>> promise;
+  };
+  auto ctx = std::make_shared<Context>(futures.size());
+  auto future = ctx->promise.getFuture();
+  for (size_t i = 0; i < futures.size(); i++) {
+    futures[i].setCallback([ctx, i](Try<T>&& t) {
+      ctx->results[i] = std::move(t);
+      if (--ctx->remaining == 0) {
+        ctx->promise.setValue(std::move(ctx->results));
+      }
+    });
+  }
+  return future;
+}
+
+/**
+ * Completes when the first of futures does, with its index and result.
+ */
+template <class T>
+Future<std::pair<size_t, Try<T>>> collectAny(std::vector<Future<T>> futures) {
+  typedef std::pair<size_t, Try<T>> Result;
+  if (futures.empty()) {
+    return makeFuture<Result>(std::make_exception_ptr(
+        FutureException("collectAny of no futures")));
+  }
+  struct Context {
+    std::atomic<bool> done{false};
+    Promise<Result> promise;
+  };
+  auto ctx = std::make_shared<Context>();
+  auto future = ctx->promise.getFuture();
+  for (size_t i = 0; i < futures.size(); i++) {
+    futures[i].setCallback([ctx, i](Try<T>&& t) {
+      if (!ctx->done.exchange(true)) {
+        ctx->promise.setValue(Result(i, std::move(t)));
+      }
+    });
+  }
+  return future;
+}
+
+} // namespace acc
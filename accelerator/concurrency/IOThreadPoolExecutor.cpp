@@ -17,14 +17,22 @@
 
 #include "accelerator/concurrency/IOThreadPoolExecutor.h"
 
+#include <algorithm>
+
+#include "accelerator/Hash.h"
+#include "accelerator/MoveWrapper.h"
+#include "accelerator/Random.h"
+
 namespace acc {
 
 IOThreadPoolExecutor::IOThreadPoolExecutor(
     size_t numThreads,
     std::shared_ptr<acc::ThreadFactory> threadFactory,
-    EventLoopManager* ebm)
+    EventLoopManager* ebm,
+    PickPolicy pickPolicy)
     : ThreadPoolExecutor(numThreads, std::move(threadFactory)),
       nextThread_(0),
+      pickPolicy_(pickPolicy),
       eventLoopManager_(ebm) {
   setNumThreads(numThreads);
 }
@@ -45,22 +53,98 @@ void IOThreadPoolExecutor::add(
   if (threadList_.get().empty()) {
     throw std::runtime_error("No threads available");
   }
-  auto ioThread = pickThread();
+  addToThread(pickThread(),
+              Task(std::move(func), expiration, std::move(expireCallback)));
+}
+
+void IOThreadPoolExecutor::addWithKey(
+    uint64_t key,
+    acc::VoidFunc func,
+    uint64_t expiration,
+    acc::VoidFunc expireCallback) {
+  acc::RWSpinLock::ReadHolder r{&threadListLock_};
+  if (threadList_.get().empty()) {
+    throw std::runtime_error("No threads available");
+  }
+  addToThread(pickThread(key),
+              Task(std::move(func), expiration, std::move(expireCallback)));
+}
+
+void IOThreadPoolExecutor::addBatch(std::vector<acc::VoidFunc> funcs) {
+  acc::RWSpinLock::ReadHolder r{&threadListLock_};
+  if (threadList_.get().empty()) {
+    throw std::runtime_error("No threads available");
+  }
+  // one contiguous chunk per picked thread
+  size_t n = funcs.size();
+  size_t chunks = std::min(n, threadList_.get().size());
+  auto it = funcs.begin();
+  for (size_t i = 0; i < chunks; i++) {
+    size_t size = n / chunks + (i < n % chunks ? 1 : 0);
+    auto ioThread = pickThread();
+    updateMaxPendingTasks(ioThread->pendingTasks += size);
+    std::vector<VoidFunc> callbacks;
+    callbacks.reserve(size);
+    for (size_t j = 0; j < size; j++, ++it) {
+      callbacks.push_back(
+          wrapTask(ioThread, Task(std::move(*it), 0, nullptr)));
+    }
+    ioThread->eventLoop->addCallbacks(std::move(callbacks));
+  }
+}
+
+void IOThreadPoolExecutor::addToThread(
+    const std::shared_ptr<IOThread>& ioThread, Task&& task) {
+  updateMaxPendingTasks(++ioThread->pendingTasks);
+  ioThread->eventLoop->addCallback(wrapTask(ioThread, std::move(task)));
+}
 
-  auto task = Task(std::move(func), expiration, std::move(expireCallback));
-  auto wrappedVoidFunc = [&]() mutable {
-    runTask(ioThread, std::move(task));
+VoidFunc IOThreadPoolExecutor::wrapTask(
+    const std::shared_ptr<IOThread>& ioThread, Task&& task) {
+  auto taskWrapper = makeMoveWrapper(std::move(task));
+  return [ioThread, taskWrapper]() mutable {
+    runTask(ioThread, std::move(*taskWrapper));
     ioThread->pendingTasks--;
   };
-
-  ioThread->pendingTasks++;
-  ioThread->eventLoop->addCallback(std::move(wrappedVoidFunc));
 }
 
 std::shared_ptr<IOThreadPoolExecutor::IOThread>
 IOThreadPoolExecutor::pickThread() {
   auto& me = *thisThread_;
   auto& ths = threadList_.get();
+  auto n = ths.size();
+  if (n == 0) {
+    return me;
+  }
+  auto pending = [&](size_t i) {
+    return std::static_pointer_cast<IOThread>(ths[i])->pendingTasks.load(
+        std::memory_order_relaxed);
+  };
+  switch (getPickPolicy()) {
+    case kTwoChoices: {
+      size_t i = Random::rand32(0, n);
+      size_t j = Random::rand32(0, n);
+      return std::static_pointer_cast<IOThread>(
+          ths[pending(j) < pending(i) ? j : i]);
+    }
+    case kLeastLoaded: {
+      // start from a rotating thread to spread ties
+      size_t start = nextThread_.fetch_add(1, std::memory_order_relaxed);
+      size_t best = start % n;
+      size_t bestPending = pending(best);
+      for (size_t k = 1; k < n && bestPending > 0; k++) {
+        size_t i = (start + k) % n;
+        size_t p = pending(i);
+        if (p < bestPending) {
+          best = i;
+          bestPending = p;
+        }
+      }
+      return std::static_pointer_cast<IOThread>(ths[best]);
+    }
+    default:
+      break;
+  }
   // When new task is added to IOThreadPoolExecutor, a thread is chosen for it
   // to be executed on, thisThread_ is by default chosen, however, if the new
   // task is added by the clean up operations on thread destruction, thisThread_
@@ -69,14 +153,17 @@ IOThreadPoolExecutor::pickThread() {
   if (me && std::find(ths.cbegin(), ths.cend(), me) != ths.cend()) {
     return me;
   }
-  auto n = ths.size();
-  if (n == 0) {
-    return me;
-  }
   auto thread = ths[nextThread_.fetch_add(1, std::memory_order_relaxed) % n];
   return std::static_pointer_cast<IOThread>(thread);
 }
 
+std::shared_ptr<IOThreadPoolExecutor::IOThread>
+IOThreadPoolExecutor::pickThread(uint64_t key) {
+  auto& ths = threadList_.get();
+  auto thread = ths[hash::twang_mix64(key) % ths.size()];
+  return std::static_pointer_cast<IOThread>(thread);
+}
+
 EventLoop* IOThreadPoolExecutor::getEventLoop() {
   acc::RWSpinLock::ReadHolder r{&threadListLock_};
   return pickThread()->eventLoop;
@@ -95,6 +182,18 @@ EventLoopManager* IOThreadPoolExecutor::getEventLoopManager() {
   return eventLoopManager_;
 }
 
+void IOThreadPoolExecutor::addListener(ListenEventFactory makeEvent) {
+  acc::RWSpinLock::ReadHolder r{&threadListLock_};
+  {
+    std::lock_guard<std::mutex> guard(listenersLock_);
+    listeners_.push_back(makeEvent);
+  }
+  for (auto& thread : threadList_.get()) {
+    auto ioThread = std::static_pointer_cast<IOThread>(thread);
+    ioThread->eventLoop->addEvent(makeEvent(ioThread->eventLoop));
+  }
+}
+
 std::shared_ptr<acc::ThreadPoolExecutor::Thread> IOThreadPoolExecutor::makeThread() {
   return std::make_shared<IOThread>(this);
 }
@@ -103,6 +202,12 @@ void IOThreadPoolExecutor::threadRun(ThreadPtr thread) {
   const auto ioThread = std::static_pointer_cast<IOThread>(thread);
   ioThread->eventLoop = eventLoopManager_->getEventLoop();
   thisThread_.reset(new std::shared_ptr<IOThread>(ioThread));
+  {
+    std::lock_guard<std::mutex> guard(listenersLock_);
+    for (auto& makeEvent : listeners_) {
+      ioThread->eventLoop->addEvent(makeEvent(ioThread->eventLoop));
+    }
+  }
 
   ioThread->eventLoop->addCallback([thread] { thread->startupBaton.post(); });
   while (ioThread->shouldRun) {
@@ -18,6 +18,9 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 #include "accelerator/concurrency/ThreadPoolExecutor.h"
 #include "accelerator/event/EventLoopManager.h"
@@ -30,14 +33,30 @@ namespace acc {
  * @note For this thread pool, stop() behaves like join() because
  * outstanding tasks belong to the event base and will be executed upon its
  * destruction.
+ *
+ * @note Each thread has its own loop, so with a TopologyThreadFactory the
+ * tasks of a thread stay on its node.
  */
 class IOThreadPoolExecutor : public acc::ThreadPoolExecutor {
  public:
+  /**
+   * How add() chooses the thread of a task, by pending tasks.
+   */
+  enum PickPolicy {
+    // the calling IO thread, otherwise round-robin
+    kRoundRobin,
+    // the less loaded of two random threads
+    kTwoChoices,
+    // the least loaded of all threads
+    kLeastLoaded,
+  };
+
   explicit IOThreadPoolExecutor(
       size_t numThreads,
       std::shared_ptr<acc::ThreadFactory> threadFactory =
           std::make_shared<acc::ThreadFactory>("IOThreadPool"),
-      EventLoopManager* ebm = EventLoopManager::get());
+      EventLoopManager* ebm = EventLoopManager::get(),
+      PickPolicy pickPolicy = kRoundRobin);
 
   ~IOThreadPoolExecutor() override;
 
@@ -46,6 +65,30 @@ class IOThreadPoolExecutor : public acc::ThreadPoolExecutor {
            uint64_t expiration,
            acc::VoidFunc expireCallback = nullptr) override;
 
+  /**
+   * Splits funcs into one contiguous chunk per thread, each picked by
+   * the pick policy and woken once.
+   */
+  void addBatch(std::vector<acc::VoidFunc> funcs) override;
+
+  /**
+   * Runs the tasks of the same key on the same thread, as long as the
+   * number of threads is unchanged, e.g. to keep the work of one
+   * connection in order and cache-warm.
+   */
+  void addWithKey(uint64_t key,
+                  acc::VoidFunc func,
+                  uint64_t expiration = 0,
+                  acc::VoidFunc expireCallback = nullptr);
+
+  void setPickPolicy(PickPolicy policy) {
+    pickPolicy_.store(policy, std::memory_order_relaxed);
+  }
+
+  PickPolicy getPickPolicy() const {
+    return pickPolicy_.load(std::memory_order_relaxed);
+  }
+
   uint64_t getPendingTaskCount() override;
 
   EventLoop* getEventLoop();
@@ -54,6 +97,19 @@ class IOThreadPoolExecutor : public acc::ThreadPoolExecutor {
 
   EventLoopManager* getEventLoopManager();
 
+  typedef std::function<EventBase*(EventLoop*)> ListenEventFactory;
+
+  /**
+   * Accepts on every IO thread, including threads added later.
+   *
+   * makeEvent is called once per thread with its EventLoop and returns
+   * a kListen event which is added to that loop. Either give each loop
+   * its own SO_REUSEPORT socket (see listenSocket), or the same socket
+   * which every loop polls with EPOLLEXCLUSIVE, so a connection wakes
+   * only one thread.
+   */
+  void addListener(ListenEventFactory makeEvent);
+
  private:
   struct ACC_ALIGN_TO_AVOID_FALSE_SHARING IOThread : public Thread {
     IOThread(IOThreadPoolExecutor* pool)
@@ -66,12 +122,19 @@ class IOThreadPoolExecutor : public acc::ThreadPoolExecutor {
 
   ThreadPtr makeThread() override;
   std::shared_ptr<IOThread> pickThread();
+  std::shared_ptr<IOThread> pickThread(uint64_t key);
+  void addToThread(const std::shared_ptr<IOThread>& ioThread, Task&& task);
+  static VoidFunc wrapTask(const std::shared_ptr<IOThread>& ioThread,
+                           Task&& task);
   void threadRun(ThreadPtr thread) override;
   void stopThreads(size_t n) override;
 
   std::atomic<size_t> nextThread_;
+  std::atomic<PickPolicy> pickPolicy_;
   acc::ThreadLocal<std::shared_ptr<IOThread>> thisThread_;
   EventLoopManager* eventLoopManager_;
+  std::vector<ListenEventFactory> listeners_;
+  std::mutex listenersLock_;
 };
 
 } // namespace acc
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/NodeTaskQueue.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace acc {
+
+NodeTaskQueue::NodeTaskQueue(
+    std::shared_ptr<const ThreadTopology> topology,
+    size_t maxQueueSize)
+  : topology_(std::move(topology)),
+    sem_(0, topology_->numNodes()) {
+  for (size_t i = 0; i < topology_->numNodes(); i++) {
+    nodes_.emplace_back(new MPMCQueue<CPUTask>(maxQueueSize));
+  }
+}
+
+void NodeTaskQueue::add(CPUTask item) {
+  if (!tryAdd(std::move(item))) {
+    throw std::runtime_error("NodeTaskQueue full, can't add item");
+  }
+}
+
+bool NodeTaskQueue::tryAdd(CPUTask&& item) {
+  size_t node = topology_->currentNode();
+  if (item.poison) {
+    poisons_++;
+  } else if (!write(node, std::move(item))) {
+    return false;
+  }
+  sem_.post(1, node);
+  return true;
+}
+
+size_t NodeTaskQueue::addBatch(std::vector<CPUTask>& items) {
+  size_t node = topology_->currentNode();
+  size_t n = 0;
+  for (auto& item : items) {
+    if (item.poison) {
+      poisons_++;
+    } else if (!write(node, std::move(item))) {
+      break;
+    }
+    n++;
+  }
+  sem_.post(n, node);
+  return n;
+}
+
+bool NodeTaskQueue::write(size_t node, CPUTask&& item) {
+  size_t n = nodes_.size();
+  for (size_t k = 0; k < n; k++) {
+    if (nodes_[(node + k) % n]->write(std::move(item))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool NodeTaskQueue::read(size_t node, CPUTask& item) {
+  if (nodes_[node]->readIfNotEmpty(item)) {
+    return true;
+  }
+  // the node is idle
+  size_t n = nodes_.size();
+  for (size_t k = 1; k < n; k++) {
+    if (nodes_[(node + k) % n]->readIfNotEmpty(item)) {
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+NodeTaskQueue::CPUTask NodeTaskQueue::take() {
+  // each permit matches one added task or poison
+  size_t node = topology_->currentNode();
+  sem_.wait(node);
+  CPUTask item;
+  while (true) {
+    if (read(node, item)) {
+      return item;
+    }
+    size_t p = poisons_.load();
+    while (p > 0) {
+      if (poisons_.compare_exchange_weak(p, p - 1)) {
+        return CPUTask();
+      }
+    }
+    // the task of our permit is being written
+    std::this_thread::yield();
+  }
+}
+
+bool NodeTaskQueue::tryTake(CPUTask& item) {
+  // keep a permit per item for take()
+  if (!sem_.tryWait()) {
+    return false;
+  }
+  size_t node = topology_->currentNode();
+  if (read(node, item)) {
+    return true;
+  }
+  // the permit is of a poison, or of a task being written
+  sem_.post(1, node);
+  return false;
+}
+
+size_t NodeTaskQueue::size() {
+  size_t n = 0;
+  for (auto& q : nodes_) {
+    n += std::max<ssize_t>(0, q->size());
+  }
+  return n;
+}
+
+} // namespace acc
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/concurrency/ThreadTopology.h"
+#include "accelerator/thread/BlockingQueue.h"
+#include "accelerator/thread/LifoSem.h"
+#include "accelerator/thread/MPMCQueue.h"
+
+namespace acc {
+
+/**
+ * Task queue of CPUThreadPoolExecutor with a queue per node of a
+ * ThreadTopology, for pools whose threads come from a
+ * TopologyThreadFactory of the same topology.
+ *
+ * Tasks go to the queue of the node of the adding thread, falling back
+ * to the other nodes when it is full, and wake an idle thread of that
+ * node, or of another node if it has none. A thread takes from the queue of
+ * its own node, and steals from the other nodes only when its node has
+ * no task left, so tasks and the data they touch stay on the node as
+ * long as it keeps up.
+ *
+ * Poison tasks of stopping threads are only taken when no task is left,
+ * so stop() still runs all outstanding tasks.
+ */
+class NodeTaskQueue
+    : public BlockingQueue<CPUThreadPoolExecutor::CPUTask> {
+ public:
+  typedef CPUThreadPoolExecutor::CPUTask CPUTask;
+
+  explicit NodeTaskQueue(
+      std::shared_ptr<const ThreadTopology> topology,
+      size_t maxQueueSize = CPUThreadPoolExecutor::kDefaultMaxQueueSize);
+
+  void add(CPUTask item) override;
+  bool tryAdd(CPUTask&& item) override;
+  size_t addBatch(std::vector<CPUTask>& items) override;
+  CPUTask take() override;
+  bool tryTake(CPUTask& item) override;
+  size_t size() override;
+
+  // tasks taken from the queue of another node
+  size_t steals() const {
+    return steals_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  bool write(size_t node, CPUTask&& item);
+  bool read(size_t node, CPUTask& item);
+
+  std::shared_ptr<const ThreadTopology> topology_;
+  std::vector<std::unique_ptr<MPMCQueue<CPUTask>>> nodes_;
+  std::atomic<size_t> poisons_{0};
+  std::atomic<size_t> steals_{0};
+  // a lane per node, a task wakes a thread of its node first
+  LifoSem sem_;
+};
+
+} // namespace acc
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/PriorityTaskQueue.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "accelerator/Logging.h"
+
+namespace acc {
+
+PriorityTaskQueue::PriorityTaskQueue(
+    uint8_t numPriorities,
+    size_t maxQueueSize,
+    size_t starvationInterval)
+  : starvationInterval_(starvationInterval) {
+  ACCCHECK_GT(numPriorities, 0);
+  for (uint8_t i = 0; i < numPriorities; i++) {
+    lanes_.emplace_back(new MPMCQueue<CPUTask>(maxQueueSize));
+  }
+}
+
+size_t PriorityTaskQueue::lane(int8_t priority) const {
+  int mid = lanes_.size() / 2;
+  int i = mid + priority;
+  return std::max(0, std::min(int(lanes_.size()) - 1, i));
+}
+
+void PriorityTaskQueue::add(CPUTask item) {
+  if (!tryAdd(std::move(item))) {
+    throw std::runtime_error("PriorityTaskQueue full, can't add item");
+  }
+}
+
+bool PriorityTaskQueue::tryAdd(CPUTask&& item) {
+  if (item.poison) {
+    poisons_++;
+  } else if (!lanes_[lane(item.stats_.priority)]->write(std::move(item))) {
+    return false;
+  }
+  sem_.post();
+  return true;
+}
+
+size_t PriorityTaskQueue::addBatch(std::vector<CPUTask>& items) {
+  size_t n = 0;
+  for (auto& item : items) {
+    if (item.poison) {
+      poisons_++;
+    } else if (!lanes_[lane(item.stats_.priority)]->write(std::move(item))) {
+      break;
+    }
+    n++;
+  }
+  sem_.post(n);
+  return n;
+}
+
+PriorityTaskQueue::CPUTask PriorityTaskQueue::take() {
+  // each permit matches one added task or poison
+  sem_.wait();
+  CPUTask item;
+  while (true) {
+    bool starved = starvationInterval_ > 0 &&
+      ++takes_ % starvationInterval_ == 0;
+    size_t n = lanes_.size();
+    for (size_t k = 0; k < n; k++) {
+      if (lanes_[starved ? k : n - 1 - k]->readIfNotEmpty(item)) {
+        return item;
+      }
+    }
+    size_t p = poisons_.load();
+    while (p > 0) {
+      if (poisons_.compare_exchange_weak(p, p - 1)) {
+        return CPUTask();
+      }
+    }
+    // the task of our permit is being written
+    std::this_thread::yield();
+  }
+}
+
+bool PriorityTaskQueue::tryTake(CPUTask& item) {
+  // keep a permit per item for take()
+  if (!sem_.tryWait()) {
+    return false;
+  }
+  for (auto& q : lanes_) {
+    if (q->readIfNotEmpty(item)) {
+      return true;
+    }
+  }
+  // the permit is of a poison, or of a task being written
+  sem_.post();
+  return false;
+}
+
+size_t PriorityTaskQueue::size() {
+  size_t n = 0;
+  for (auto& q : lanes_) {
+    n += std::max<ssize_t>(0, q->size());
+  }
+  return n;
+}
+
+} // namespace acc
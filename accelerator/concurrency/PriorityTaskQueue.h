@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/thread/BlockingQueue.h"
+#include "accelerator/thread/LifoSem.h"
+#include "accelerator/thread/MPMCQueue.h"
+
+namespace acc {
+
+/**
+ * Task queue of CPUThreadPoolExecutor with a lane per priority.
+ *
+ * Each lane is a lock-free MPMCQueue, tasks are taken from the highest
+ * non-empty lane, FIFO within a lane. With a starvationInterval of n,
+ * every n-th take serves the lowest non-empty lane instead, so a burst
+ * of high priority work cannot hold low priority tasks back forever;
+ * 0 means strict priorities.
+ *
+ * Poison tasks of stopping threads are only taken when all lanes are
+ * empty, so stop() still runs all outstanding tasks.
+ *
+ * Usage:
+ *
+ *   CPUThreadPoolExecutor pool(n, make_unique<PriorityTaskQueue>(3));
+ *   pool.addWithPriority(func, Executor::HI_PRI);
+ */
+class PriorityTaskQueue
+    : public BlockingQueue<CPUThreadPoolExecutor::CPUTask> {
+ public:
+  typedef CPUThreadPoolExecutor::CPUTask CPUTask;
+
+  explicit PriorityTaskQueue(
+      uint8_t numPriorities,
+      size_t maxQueueSize = CPUThreadPoolExecutor::kDefaultMaxQueueSize,
+      size_t starvationInterval = 0);
+
+  void add(CPUTask item) override;
+  bool tryAdd(CPUTask&& item) override;
+  size_t addBatch(std::vector<CPUTask>& items) override;
+  CPUTask take() override;
+  // takes from the lowest non-empty lane
+  bool tryTake(CPUTask& item) override;
+  size_t size() override;
+
+  uint8_t getNumPriorities() override {
+    return lanes_.size();
+  }
+
+  // lane of priority, saturated at the lowest and highest lanes
+  size_t lane(int8_t priority) const;
+
+ private:
+  std::vector<std::unique_ptr<MPMCQueue<CPUTask>>> lanes_;
+  const size_t starvationInterval_;
+  std::atomic<size_t> takes_{0};
+  std::atomic<size_t> poisons_{0};
+  LifoSem sem_;
+};
+
+} // namespace acc
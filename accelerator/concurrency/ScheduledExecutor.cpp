@@ -0,0 +1,258 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/ScheduledExecutor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <typeinfo>
+
+#include "accelerator/Logging.h"
+#include "accelerator/Random.h"
+#include "accelerator/Time.h"
+#include "accelerator/thread/ThreadUtil.h"
+
+namespace acc {
+
+namespace {
+
+void invoke(const VoidFunc& func) {
+  try {
+    func();
+  } catch (const std::exception& e) {
+    ACCLOG(ERROR) << "ScheduledExecutor: func threw unhandled "
+                  << typeid(e).name() << " exception: " << e.what();
+  } catch (...) {
+    ACCLOG(ERROR) << "ScheduledExecutor: func threw unhandled non-exception "
+                     "object";
+  }
+}
+
+} // namespace
+
+void ScheduledExecutor::Handle::cancel() {
+  if (task_ && !task_->cancelled.exchange(true, std::memory_order_acq_rel)) {
+    if (auto core = task_->core.lock()) {
+      core->cancel();
+    }
+  }
+}
+
+bool ScheduledExecutor::Handle::cancelled() const {
+  return task_ && task_->cancelled.load(std::memory_order_acquire);
+}
+
+ScheduledExecutor::ScheduledExecutor(std::shared_ptr<Executor> executor)
+  : core_(std::make_shared<Core>()) {
+  core_->executor = std::move(executor);
+  auto core = core_;
+  thread_ = std::thread([core]() { core->loop(core); });
+}
+
+ScheduledExecutor::~ScheduledExecutor() {
+  stop();
+}
+
+void ScheduledExecutor::stop() {
+  {
+    std::lock_guard<std::mutex> guard(core_->lock);
+    core_->stopping = true;
+    core_->heap.clear();
+    core_->cancelled = 0;
+  }
+  core_->cond.notify_one();
+  if (thread_.joinable()) {
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      // from a task run on the timer thread
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+}
+
+size_t ScheduledExecutor::pending() const {
+  std::lock_guard<std::mutex> guard(core_->lock);
+  return core_->heap.size();
+}
+
+ScheduledExecutor::Handle
+ScheduledExecutor::schedule(VoidFunc func, uint64_t delay) {
+  return add(std::move(func), kOnce, delay, 0, 0);
+}
+
+ScheduledExecutor::Handle
+ScheduledExecutor::scheduleAtFixedRate(VoidFunc func,
+                                       uint64_t initialDelay,
+                                       uint64_t period,
+                                       uint64_t jitter) {
+  ACCCHECK_GT(period, 0);
+  return add(std::move(func), kFixedRate, initialDelay, period, jitter);
+}
+
+ScheduledExecutor::Handle
+ScheduledExecutor::scheduleWithFixedDelay(VoidFunc func,
+                                          uint64_t initialDelay,
+                                          uint64_t delay,
+                                          uint64_t jitter) {
+  return add(std::move(func), kFixedDelay, initialDelay, delay, jitter);
+}
+
+ScheduledExecutor::Handle
+ScheduledExecutor::add(VoidFunc&& func, Kind kind, uint64_t initialDelay,
+                       uint64_t period, uint64_t jitter) {
+  auto task = std::make_shared<Task>();
+  task->func = std::move(func);
+  task->kind = kind;
+  task->period = period;
+  task->jitter = jitter;
+  task->base = timestampNow() + initialDelay;
+  task->core = core_;
+  if (!core_->push(task)) {
+    return Handle();
+  }
+  return Handle(std::move(task));
+}
+
+bool ScheduledExecutor::Core::push(std::shared_ptr<Task> task) {
+  uint64_t deadline = task->base;
+  if (task->jitter > 0) {
+    deadline += Random::rand64(0, task->jitter);
+  }
+  bool earliest;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (stopping) {
+      return false;
+    }
+    heap.push_back(Entry{deadline, seq++, std::move(task)});
+    std::push_heap(heap.begin(), heap.end());
+    earliest = heap.front().seq == seq - 1;
+  }
+  // the timer sleeps until a later deadline
+  if (earliest) {
+    cond.notify_one();
+  }
+  return true;
+}
+
+void ScheduledExecutor::Core::cancel() {
+  std::lock_guard<std::mutex> guard(lock);
+  // counts a task out of the heap too, the compaction recounts
+  if (++cancelled * 2 < heap.size()) {
+    return;
+  }
+  heap.erase(std::remove_if(heap.begin(), heap.end(), [](const Entry& e) {
+    return e.task->cancelled.load(std::memory_order_acquire);
+  }), heap.end());
+  std::make_heap(heap.begin(), heap.end());
+  cancelled = 0;
+}
+
+void ScheduledExecutor::Core::loop(const std::shared_ptr<Core>& self) {
+  setCurrentThreadName("ScheduledTimer");
+  std::unique_lock<std::mutex> guard(lock);
+  while (!stopping) {
+    if (heap.empty()) {
+      cond.wait(guard);
+      continue;
+    }
+    uint64_t now = timestampNow();
+    uint64_t deadline = heap.front().deadline;
+    if (deadline > now) {
+      cond.wait_for(guard, std::chrono::microseconds(deadline - now));
+      continue;
+    }
+    std::pop_heap(heap.begin(), heap.end());
+    std::shared_ptr<Task> task = std::move(heap.back().task);
+    heap.pop_back();
+    if (task->cancelled.load(std::memory_order_acquire)) {
+      if (cancelled > 0) {
+        cancelled--;
+      }
+      continue;
+    }
+    guard.unlock();
+    run(self, std::move(task));
+    guard.lock();
+  }
+}
+
+void ScheduledExecutor::Core::run(const std::shared_ptr<Core>& self,
+                                  std::shared_ptr<Task> task) {
+  switch (task->kind) {
+    case kOnce: {
+      VoidFunc func = std::move(task->func);
+      dispatch([func]() { invoke(func); });
+      break;
+    }
+    case kFixedRate: {
+      dispatch([task]() {
+        if (!task->cancelled.load(std::memory_order_acquire)) {
+          invoke(task->func);
+        }
+      });
+      // next on the grid after now, skipping the missed runs, even if
+      // this run was not dispatched
+      uint64_t now = timestampNow();
+      uint64_t next = task->base + task->period;
+      if (next <= now) {
+        next += ((now - next) / task->period + 1) * task->period;
+      }
+      task->base = next;
+      push(std::move(task));
+      break;
+    }
+    case kFixedDelay: {
+      std::shared_ptr<Core> core = self;
+      bool dispatched = dispatch([core, task]() {
+        if (task->cancelled.load(std::memory_order_acquire)) {
+          return;
+        }
+        invoke(task->func);
+        task->base = timestampNow() + task->period;
+        core->push(task);
+      });
+      // not run, so the run does not push it either
+      if (!dispatched) {
+        task->base = timestampNow() + task->period;
+        push(std::move(task));
+      }
+      break;
+    }
+  }
+}
+
+bool ScheduledExecutor::Core::dispatch(VoidFunc&& func) {
+  if (!executor) {
+    func();
+    return true;
+  }
+  // thrown on the timer thread, it would terminate the process
+  try {
+    executor->add(std::move(func));
+    return true;
+  } catch (const std::exception& e) {
+    ACCLOG(ERROR) << "ScheduledExecutor: executor add threw "
+                  << typeid(e).name() << " exception: " << e.what();
+  } catch (...) {
+    ACCLOG(ERROR) << "ScheduledExecutor: executor add threw non-exception "
+                     "object";
+  }
+  return false;
+}
+
+} // namespace acc
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "accelerator/concurrency/Executor.h"
+
+namespace acc {
+
+/**
+ * Timer thread adding tasks to an executor once they are due.
+ *
+ * Deadlines are kept in a min-heap, and the thread sleeps on a condition
+ * variable until the earliest one, or until an earlier task is scheduled.
+ * An idle ScheduledExecutor does not wake up at all.
+ *
+ * Times are in us. Periodic tasks are run:
+ * - at fixed rate: due on the grid initialDelay + k * period, so a late
+ *   run does not shift the next ones. Runs missed while behind by more
+ *   than a period are skipped.
+ * - with fixed delay: due delay after the end of the previous run, they
+ *   never overlap.
+ * jitter, if any, delays each run by a random time below it, apart from
+ * the grid, to spread tasks started together.
+ *
+ * Tasks run on the executor, or on the timer thread if there is none,
+ * which suits only short tasks. A run the executor rejects is logged and
+ * skipped, periodic tasks stay scheduled.
+ *
+ * Cancelled tasks stay in the heap until due, unless they make up half
+ * of it, in which case the heap is compacted on cancel.
+ *
+ * Usage:
+ *
+ *   ScheduledExecutor scheduler(pool);
+ *   auto handle = scheduler.scheduleAtFixedRate(func, 0, 1000000);
+ *   ...
+ *   handle.cancel();
+ */
+class ScheduledExecutor {
+ private:
+  struct Task;
+  struct Core;
+
+ public:
+  // Cancellation handle of a scheduled task, copyable.
+  class Handle {
+   public:
+    Handle() {}
+
+    // The task is not run any more, a run in progress completes.
+    void cancel();
+
+    bool cancelled() const;
+
+    // false for a default constructed handle
+    explicit operator bool() const {
+      return task_ != nullptr;
+    }
+
+   private:
+    friend class ScheduledExecutor;
+
+    explicit Handle(std::shared_ptr<Task> task) : task_(std::move(task)) {}
+
+    std::shared_ptr<Task> task_;
+  };
+
+  explicit ScheduledExecutor(std::shared_ptr<Executor> executor = nullptr);
+
+  // Stops, the pending tasks are dropped.
+  ~ScheduledExecutor();
+
+  ScheduledExecutor(const ScheduledExecutor&) = delete;
+  ScheduledExecutor& operator=(const ScheduledExecutor&) = delete;
+
+  // Runs func once after delay. After stop, the task is dropped and the
+  // handle returned is empty, as for all the schedule functions.
+  Handle schedule(VoidFunc func, uint64_t delay);
+
+  Handle scheduleAtFixedRate(VoidFunc func,
+                             uint64_t initialDelay,
+                             uint64_t period,
+                             uint64_t jitter = 0);
+
+  Handle scheduleWithFixedDelay(VoidFunc func,
+                                uint64_t initialDelay,
+                                uint64_t delay,
+                                uint64_t jitter = 0);
+
+  // Stops the timer thread and drops the pending tasks, idempotent.
+  void stop();
+
+  // tasks waiting for their deadline, cancelled ones included until due
+  // or compacted
+  size_t pending() const;
+
+ private:
+  enum Kind {
+    kOnce,
+    kFixedRate,
+    kFixedDelay,
+  };
+
+  struct Task {
+    VoidFunc func;
+    Kind kind;
+    uint64_t period;
+    uint64_t jitter;
+    uint64_t base;    // due time before jitter
+    std::atomic<bool> cancelled{false};
+    std::weak_ptr<Core> core;
+  };
+
+  struct Entry {
+    uint64_t deadline;
+    uint64_t seq;
+    std::shared_ptr<Task> task;
+
+    // reversed for a min-heap
+    bool operator<(const Entry& other) const {
+      return deadline != other.deadline
+        ? deadline > other.deadline
+        : seq > other.seq;
+    }
+  };
+
+  // shared with the runs of fixed delay tasks, which may end after stop
+  struct Core {
+    std::shared_ptr<Executor> executor;
+    mutable std::mutex lock;
+    std::condition_variable cond;
+    std::vector<Entry> heap;
+    uint64_t seq{0};
+    // cancelled tasks in heap, at most
+    size_t cancelled{0};
+    bool stopping{false};
+
+    bool push(std::shared_ptr<Task> task);
+    void cancel();
+    void loop(const std::shared_ptr<Core>& self);
+    void run(const std::shared_ptr<Core>& self, std::shared_ptr<Task> task);
+    // false if the executor threw, the task is then not run
+    bool dispatch(VoidFunc&& func);
+  };
+
+  Handle add(VoidFunc&& func, Kind kind, uint64_t initialDelay,
+             uint64_t period, uint64_t jitter);
+
+  std::shared_ptr<Core> core_;
+  std::thread thread_;
+};
+
+} // namespace acc
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/SerialExecutor.h"
+
+#include <typeinfo>
+
+#include "accelerator/Logging.h"
+
+namespace acc {
+
+std::shared_ptr<SerialExecutor> SerialExecutor::create(
+    std::shared_ptr<Executor> parent) {
+  return std::shared_ptr<SerialExecutor>(
+      new SerialExecutor(std::move(parent)));
+}
+
+SerialExecutor::SerialExecutor(std::shared_ptr<Executor> parent)
+  : parent_(std::move(parent)) {}
+
+void SerialExecutor::add(VoidFunc func) {
+  queue_.insertHead(std::move(func));
+  // counted after the insert, a run takes no more than it can find
+  if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+    schedule();
+  }
+}
+
+void SerialExecutor::addBatch(std::vector<VoidFunc> funcs) {
+  if (funcs.empty()) {
+    return;
+  }
+  queue_.insertHead(funcs.begin(), funcs.end());
+  if (pending_.fetch_add(funcs.size(), std::memory_order_acq_rel) == 0) {
+    schedule();
+  }
+}
+
+void SerialExecutor::schedule() {
+  auto self = shared_from_this();
+  try {
+    parent_->add([self]() { self->run(); });
+  } catch (...) {
+    // no run is active, so the strand drops what it holds and counts it
+    // off pending_, the next add schedules it again. Tasks counted
+    // meanwhile did not schedule, they are dropped too. Below zero, the
+    // adds of swept tasks are still to count, and the one of them taking
+    // pending_ from zero schedules.
+    size_t dropped = 0;
+    size_t n = taken_.size();
+    taken_.clear();
+    while (true) {
+      queue_.sweepOnce([&](VoidFunc&&) { n++; });
+      dropped += n;
+      size_t prev = pending_.fetch_sub(n, std::memory_order_acq_rel);
+      if (ssize_t(prev - n) <= 0) {
+        break;
+      }
+      n = 0;
+    }
+    ACCLOG(ERROR) << "SerialExecutor: parent add threw, dropped "
+                  << dropped << " tasks";
+    throw;
+  }
+}
+
+void SerialExecutor::run() {
+  size_t n = pending_.load(std::memory_order_acquire);
+  if (taken_.size() < n) {
+    queue_.sweepOnce([&](VoidFunc&& func) {
+      taken_.push_back(std::move(func));
+    });
+  }
+  for (size_t i = 0; i < n; i++) {
+    VoidFunc func = std::move(taken_.front());
+    taken_.pop_front();
+    try {
+      func();
+    } catch (const std::exception& e) {
+      ACCLOG(ERROR) << "SerialExecutor: func threw unhandled "
+                    << typeid(e).name() << " exception: " << e.what();
+    } catch (...) {
+      ACCLOG(ERROR) << "SerialExecutor: func threw unhandled non-exception "
+                       "object";
+    }
+  }
+  // the tasks added meanwhile are run by the next turn
+  if (pending_.fetch_sub(n, std::memory_order_acq_rel) > n) {
+    schedule();
+  }
+}
+
+} // namespace acc
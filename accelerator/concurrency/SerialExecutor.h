@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include "accelerator/concurrency/Executor.h"
+#include "accelerator/thread/AtomicLinkedList.h"
+
+namespace acc {
+
+/**
+ * Executor running its tasks one at a time in FIFO order, on the threads
+ * of a parent executor.
+ *
+ * Tasks are added lock-free, and the SerialExecutor is scheduled on the
+ * parent only when its queue turns non-empty. Each run handles the tasks
+ * queued when it starts, then reschedules itself if more were added, so
+ * a busy strand does not hold a worker of the parent forever.
+ *
+ * If the parent throws on add, the tasks queued on the strand are dropped
+ * and the exception is rethrown, from add() or from the run rescheduling
+ * the strand. The strand stays usable.
+ *
+ * A SerialExecutor per key (session, connection, ...) orders the work of
+ * the key without a mutex on which the workers would block.
+ *
+ * Usage:
+ *
+ *   auto pool = std::make_shared<CPUThreadPoolExecutor>(8);
+ *   auto strand = SerialExecutor::create(pool);
+ *   strand->add([]() { ... });
+ */
+class SerialExecutor : public Executor,
+                       public std::enable_shared_from_this<SerialExecutor> {
+ public:
+  static std::shared_ptr<SerialExecutor> create(
+      std::shared_ptr<Executor> parent);
+
+  ~SerialExecutor() override {}
+
+  SerialExecutor(const SerialExecutor&) = delete;
+  SerialExecutor& operator=(const SerialExecutor&) = delete;
+
+  void add(VoidFunc func) override;
+
+  // Adds the funcs in order, scheduling on the parent at most once.
+  void addBatch(std::vector<VoidFunc> funcs) override;
+
+  Executor* parent() const {
+    return parent_.get();
+  }
+
+ private:
+  explicit SerialExecutor(std::shared_ptr<Executor> parent);
+
+  void schedule();
+  void run();
+
+  std::shared_ptr<Executor> parent_;
+
+  AtomicLinkedList<VoidFunc> queue_;
+  // tasks added and not run yet, the strand is scheduled while non-zero
+  std::atomic<size_t> pending_{0};
+  // taken off queue_ beyond the count of a run, by the running strand only
+  std::deque<VoidFunc> taken_;
+};
+
+} // namespace acc
@@ -33,7 +33,9 @@ class ThreadFactory {
   ThreadFactory(StringPiece prefix)
     : prefix_(prefix.str()) {}
 
-  std::thread newThread(VoidFunc&& func) {
+  virtual ~ThreadFactory() {}
+
+  virtual std::thread newThread(VoidFunc&& func) {
     auto name = to<std::string>(prefix_, suffix_++);
     auto fnw = makeMoveWrapper(std::move(func));
     return std::thread(
@@ -25,7 +25,8 @@ ThreadPoolExecutor::ThreadPoolExecutor(
     size_t /* numThreads */,
     std::shared_ptr<ThreadFactory> threadFactory)
     : threadFactory_(std::move(threadFactory)),
-      taskStatsCallbacks_(std::make_shared<TaskStatsCallbackRegistry>()) {}
+      taskStatsCallbacks_(std::make_shared<TaskStatsCallbackRegistry>()),
+      taskCounters_(std::make_shared<TaskCounters>()) {}
 
 ThreadPoolExecutor::~ThreadPoolExecutor() {
   ACCCHECK_EQ(0, threadList_.get().size());
@@ -62,9 +63,23 @@ ThreadPoolExecutor::Task::operator=(Task&& other) noexcept {
 
 void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   thread->idle = false;
+  executeTask(task, *thread->taskCounters);
+  thread->idle = true;
+  thread->lastActiveTime = timestampNow();
+  reportTaskStats(*thread->taskStatsCallbacks, task);
+}
+
+void ThreadPoolExecutor::runTaskInline(Task&& task) {
+  executeTask(task, *taskCounters_);
+  reportTaskStats(*taskStatsCallbacks_, task);
+}
+
+void ThreadPoolExecutor::executeTask(Task& task, TaskCounters& counters) {
   auto startTime = timestampNow();
   task.stats_.waitTime = startTime - task.enqueueTime_;
-  if (task.expiration_ > 0 && task.stats_.waitTime >= task.expiration_) {
+  // the queue may have expired a hopeless task already
+  if (task.stats_.expired ||
+      (task.expiration_ > 0 && task.stats_.waitTime >= task.expiration_)) {
     task.stats_.expired = true;
     if (task.expireCallback_ != nullptr) {
       task.expireCallback_();
@@ -80,13 +95,25 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
                        "object";
     }
     task.stats_.runTime = timestampNow() - startTime;
+    task.stats_.missedDeadline = task.expiration_ > 0 &&
+      task.stats_.waitTime + task.stats_.runTime > task.expiration_;
   }
-  thread->idle = true;
-  thread->lastActiveTime = timestampNow();
-  auto lockedCallbacks = thread->taskStatsCallbacks->callbackList.rlock();
-  *thread->taskStatsCallbacks->inCallback = true;
+  if (task.expiration_ > 0) {
+    counters.deadlineTasks++;
+    if (task.stats_.expired) {
+      counters.expiredTasks++;
+    } else if (task.stats_.missedDeadline) {
+      counters.missedDeadlines++;
+    }
+  }
+}
+
+void ThreadPoolExecutor::reportTaskStats(
+    TaskStatsCallbackRegistry& callbacks, const Task& task) {
+  auto lockedCallbacks = callbacks.callbackList.rlock();
+  *callbacks.inCallback = true;
   SCOPE_EXIT {
-    *thread->taskStatsCallbacks->inCallback = false;
+    *callbacks.inCallback = false;
   };
   try {
     for (auto& callback : *lockedCallbacks) {
@@ -200,6 +227,11 @@ ThreadPoolExecutor::PoolStats ThreadPoolExecutor::getPoolStats() {
   }
   stats.pendingTaskCount = getPendingTaskCount();
   stats.totalTaskCount = stats.pendingTaskCount + stats.activeThreadCount;
+  stats.maxPendingTaskCount = maxPendingTasks_;
+  stats.rejectedTaskCount = rejectedTasks_;
+  stats.deadlineTaskCount = taskCounters_->deadlineTasks;
+  stats.expiredTaskCount = taskCounters_->expiredTasks;
+  stats.missedDeadlineCount = taskCounters_->missedDeadlines;
   return stats;
 }
 
@@ -67,9 +67,21 @@ class ThreadPoolExecutor : public virtual Executor {
           activeThreadCount(0),
           pendingTaskCount(0),
           totalTaskCount(0),
+          maxPendingTaskCount(0),
+          rejectedTaskCount(0),
+          deadlineTaskCount(0),
+          expiredTaskCount(0),
+          missedDeadlineCount(0),
           maxIdleTime(0) {}
     size_t threadCount, idleThreadCount, activeThreadCount;
     size_t pendingTaskCount, totalTaskCount;
+    // high-water mark of the queue depth (per IO thread for IO pools)
+    size_t maxPendingTaskCount;
+    // tasks not queued by the overflow policy
+    size_t rejectedTaskCount;
+    // done tasks with an expiration, of which expired without running,
+    // or ran but finished past the expiration
+    size_t deadlineTaskCount, expiredTaskCount, missedDeadlineCount;
     uint64_t maxIdleTime;
   };
 
@@ -77,8 +89,16 @@ class ThreadPoolExecutor : public virtual Executor {
   virtual uint64_t getPendingTaskCount() = 0;
 
   struct TaskStats {
-    TaskStats() : expired(false), waitTime(0), runTime(0) {}
+    TaskStats()
+        : expired(false),
+          missedDeadline(false),
+          priority(MID_PRI),
+          waitTime(0),
+          runTime(0) {}
     bool expired;
+    // finished past the expiration
+    bool missedDeadline;
+    int8_t priority;
     uint64_t waitTime;
     uint64_t runTime;
   };
@@ -123,6 +143,7 @@ class ThreadPoolExecutor : public virtual Executor {
   void removeThreads(size_t n, bool isJoin);
 
   struct TaskStatsCallbackRegistry;
+  struct TaskCounters;
 
   struct ACC_ALIGN_TO_AVOID_FALSE_SHARING Thread : public ThreadHandle {
     explicit Thread(ThreadPoolExecutor* pool)
@@ -130,7 +151,8 @@ class ThreadPoolExecutor : public virtual Executor {
           handle(),
           idle(true),
           lastActiveTime(timestampNow()),
-          taskStatsCallbacks(pool->taskStatsCallbacks_) {}
+          taskStatsCallbacks(pool->taskStatsCallbacks_),
+          taskCounters(pool->taskCounters_) {}
 
     ~Thread() override = default;
 
@@ -141,6 +163,7 @@ class ThreadPoolExecutor : public virtual Executor {
     uint64_t lastActiveTime;
     Baton startupBaton;
     std::shared_ptr<TaskStatsCallbackRegistry> taskStatsCallbacks;
+    std::shared_ptr<TaskCounters> taskCounters;
   };
 
   typedef std::shared_ptr<Thread> ThreadPtr;
@@ -163,6 +186,10 @@ class ThreadPoolExecutor : public virtual Executor {
 
   static void runTask(const ThreadPtr& thread, Task&& task);
 
+  // Runs (or expires) task on the calling thread, with the same stats
+  // and exception guard as runTask(), outside of any pool thread.
+  void runTaskInline(Task&& task);
+
   // The function that will be bound to pool threads. It must call
   // thread->startupBaton.post() when it's ready to consume work.
   virtual void threadRun(ThreadPtr thread) = 0;
@@ -178,6 +205,13 @@ class ThreadPoolExecutor : public virtual Executor {
   // require a lock on ThreadPoolExecutor.
   void joinStoppedThreads(size_t n);
 
+  void updateMaxPendingTasks(size_t n) {
+    size_t max = maxPendingTasks_.load(std::memory_order_relaxed);
+    while (n > max &&
+           !maxPendingTasks_.compare_exchange_weak(
+               max, n, std::memory_order_relaxed)) {}
+  }
+
   // Create a suitable Thread struct
   virtual ThreadPtr makeThread() {
     return std::make_shared<Thread>(this);
@@ -233,12 +267,27 @@ class ThreadPoolExecutor : public virtual Executor {
   RWSpinLock threadListLock_;
   GenericBlockingQueue<ThreadPtr> stoppedThreads_;
   std::atomic<bool> isJoin_; // whether the current downsizing is a join
+  std::atomic<size_t> maxPendingTasks_{0};
+  std::atomic<size_t> rejectedTasks_{0};
 
   struct TaskStatsCallbackRegistry {
     ThreadLocal<bool> inCallback;
     Synchronized<std::vector<TaskStatsCallback>> callbackList;
   };
   std::shared_ptr<TaskStatsCallbackRegistry> taskStatsCallbacks_;
+
+  // of tasks with an expiration only, to keep other tasks uncontended
+  struct TaskCounters {
+    std::atomic<size_t> deadlineTasks{0};
+    std::atomic<size_t> expiredTasks{0};
+    std::atomic<size_t> missedDeadlines{0};
+  };
+  std::shared_ptr<TaskCounters> taskCounters_;
+
+  static void executeTask(Task& task, TaskCounters& counters);
+  static void reportTaskStats(TaskStatsCallbackRegistry& callbacks,
+                              const Task& task);
+
   std::vector<std::shared_ptr<Observer>> observers_;
 };
 
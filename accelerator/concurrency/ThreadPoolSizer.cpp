@@ -0,0 +1,110 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/ThreadPoolSizer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace acc {
+
+ThreadPoolSizer::ThreadPoolSizer(
+    std::shared_ptr<ThreadPoolExecutor> pool,
+    const Options& options)
+  : pool_(std::move(pool)),
+    options_(options),
+    window_(std::make_shared<Window>()) {
+  ACCCHECK_GT(options_.minThreads, 0);
+  ACCCHECK_LE(options_.minThreads, options_.maxThreads);
+  auto window = window_;
+  pool_->subscribeToTaskStats([window](ThreadPoolExecutor::TaskStats stats) {
+    window->waitTime.fetch_add(stats.waitTime, std::memory_order_relaxed);
+    window->runTime.fetch_add(stats.runTime, std::memory_order_relaxed);
+    window->tasks.fetch_add(1, std::memory_order_relaxed);
+  });
+}
+
+ThreadPoolSizer::~ThreadPoolSizer() {
+  stop();
+}
+
+size_t ThreadPoolSizer::update() {
+  uint64_t tasks = window_->tasks.exchange(0);
+  uint64_t waitTime = window_->waitTime.exchange(0);
+  uint64_t runTime = window_->runTime.exchange(0);
+  if (tasks > 0) {
+    lastWaitTime_ = waitTime / tasks;
+    lastRunTime_ = runTime / tasks;
+  }
+  auto stats = pool_->getPoolStats();
+  size_t n = stats.threadCount;
+  size_t target = n;
+  if (tasks > 0 && lastWaitTime_ > options_.targetWaitTime) {
+    target = std::max(
+        n + 1,
+        size_t(n * (lastWaitTime_ + lastRunTime_) /
+               (options_.targetWaitTime + lastRunTime_)));
+  } else if (tasks == 0 && stats.pendingTaskCount > 0) {
+    target = n + 1;
+  } else if (stats.idleThreadCount > 0 &&
+             stats.maxIdleTime >= options_.idleTimeout) {
+    target = n - 1;
+  }
+  target = std::max(options_.minThreads,
+                    std::min(options_.maxThreads, target));
+  if (target != n) {
+    ACCLOG(DEBUG) << "ThreadPoolSizer: " << n << " -> " << target
+                  << " threads, wait " << lastWaitTime_
+                  << "us, run " << lastRunTime_ << "us";
+    pool_->setNumThreads(target);
+  }
+  return target;
+}
+
+void ThreadPoolSizer::start() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!running_) {
+    running_ = true;
+    handle_ = std::thread(&ThreadPoolSizer::run, this);
+  }
+}
+
+void ThreadPoolSizer::stop() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cv_.notify_one();
+  handle_.join();
+}
+
+void ThreadPoolSizer::run() {
+  setCurrentThreadName("ThreadPoolSizer");
+  std::unique_lock<std::mutex> guard(lock_);
+  while (running_) {
+    cv_.wait_for(guard, std::chrono::microseconds(options_.interval));
+    if (running_) {
+      guard.unlock();
+      update();
+      guard.lock();
+    }
+  }
+}
+
+} // namespace acc
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "accelerator/concurrency/ThreadPoolExecutor.h"
+
+namespace acc {
+
+/**
+ * Controller sizing a ThreadPoolExecutor by its load.
+ *
+ * At each update, the TaskStats of the tasks done since the previous
+ * update are averaged. While the mean queue wait is above targetWaitTime
+ * the pool grows, to the size which by Little's law brings the time of a
+ * task in the pool (wait + run) down to the target wait plus its run
+ * time. A pool with pending tasks but none done grows by one thread.
+ * Otherwise, once a thread has been idle for idleTimeout, the pool
+ * shrinks by one thread per update. The size always stays within
+ * [minThreads, maxThreads].
+ *
+ * Stop the sizer before joining the pool.
+ *
+ * Usage:
+ *
+ *   auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+ *   ThreadPoolSizer::Options options;
+ *   options.maxThreads = 32;
+ *   ThreadPoolSizer sizer(pool, options);
+ *   sizer.start();
+ */
+class ThreadPoolSizer {
+ public:
+  struct Options {
+    Options()
+        : minThreads(1),
+          maxThreads(std::max(1u, std::thread::hardware_concurrency())),
+          targetWaitTime(1000),
+          idleTimeout(60000000),
+          interval(100000) {}
+    size_t minThreads, maxThreads;
+    // mean queue wait above which the pool grows
+    uint64_t targetWaitTime;
+    // idle time of a thread after which the pool shrinks
+    uint64_t idleTimeout;
+    // between updates of start()
+    uint64_t interval;
+  };
+
+  ThreadPoolSizer(std::shared_ptr<ThreadPoolExecutor> pool,
+                  const Options& options = Options());
+
+  ~ThreadPoolSizer();
+
+  // Resizes the pool once, returns the number of threads.
+  size_t update();
+
+  // Updates every interval on a thread of its own, until stop().
+  void start();
+  void stop();
+
+  // mean wait and run time of the tasks at the last update
+  uint64_t lastWaitTime() const {
+    return lastWaitTime_;
+  }
+  uint64_t lastRunTime() const {
+    return lastRunTime_;
+  }
+
+ private:
+  // shared with the task stats callback, which outlives the sizer
+  struct Window {
+    std::atomic<uint64_t> tasks{0};
+    std::atomic<uint64_t> waitTime{0};
+    std::atomic<uint64_t> runTime{0};
+  };
+
+  void run();
+
+  std::shared_ptr<ThreadPoolExecutor> pool_;
+  Options options_;
+  std::shared_ptr<Window> window_;
+  uint64_t lastWaitTime_{0};
+  uint64_t lastRunTime_{0};
+  std::thread handle_;
+  bool running_{false};
+  std::mutex lock_;
+  std::condition_variable cv_;
+};
+
+} // namespace acc
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/ThreadTopology.h"
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+
+#include <algorithm>
+
+#include "accelerator/Logging.h"
+#include "accelerator/SysUtil.h"
+
+namespace acc {
+
+namespace {
+
+thread_local const ThreadTopology* tlTopology = nullptr;
+thread_local size_t tlNode = 0;
+
+} // namespace
+
+ThreadTopology::ThreadTopology(const CacheLocality& locality,
+                               PinLevel pinLevel)
+  : pinLevel_(pinLevel) {
+  size_t numCpus = locality.numCpus;
+  size_t numNodes = locality.numCachesByLevel.empty()
+    ? 1 : std::max(size_t(1), locality.numCachesByLevel.back());
+  ACCCHECK_GT(numCpus, 0);
+  ACCCHECK_EQ(numCpus, locality.localityIndexByCpu.size());
+
+  std::vector<int> cpuByIndex(numCpus);
+  for (size_t cpu = 0; cpu < numCpus; cpu++) {
+    cpuByIndex[locality.localityIndexByCpu[cpu]] = cpu;
+  }
+  // last-level caches are contiguous in locality index, as AccessSpreader
+  nodeCpus_.resize(std::min(numNodes, numCpus));
+  nodeByCpu_.resize(numCpus);
+  for (size_t index = 0; index < numCpus; index++) {
+    size_t node = index * nodeCpus_.size() / numCpus;
+    nodeCpus_[node].push_back(cpuByIndex[index]);
+    nodeByCpu_[cpuByIndex[index]] = node;
+  }
+}
+
+std::vector<int> ThreadTopology::cpusOfThread(size_t index) const {
+  auto& cpus = nodeCpus_[nodeOfThread(index)];
+  switch (pinLevel_) {
+    case kPinCpu:
+      return {cpus[index / numNodes() % cpus.size()]};
+    case kPinCache:
+      return cpus;
+    default:
+      return {};
+  }
+}
+
+void ThreadTopology::bindThread(size_t index) const {
+  tlTopology = this;
+  tlNode = nodeOfThread(index);
+  auto cpus = cpusOfThread(index);
+  if (!cpus.empty() && !setCpuAffinity(cpus)) {
+    ACCPLOG(WARN) << "pin thread " << index << " to node " << tlNode;
+  }
+}
+
+size_t ThreadTopology::currentNode() const {
+  if (tlTopology == this) {
+    return tlNode;
+  }
+  int cpu = sched_getcpu();
+  return cpu >= 0 ? nodeOfCpu(cpu) : 0;
+}
+
+} // namespace acc
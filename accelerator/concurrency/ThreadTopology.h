@@ -0,0 +1,123 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "accelerator/MoveWrapper.h"
+#include "accelerator/concurrency/ThreadFactory.h"
+#include "accelerator/thread/CacheLocality.h"
+
+namespace acc {
+
+/**
+ * Placement of pool threads on the cpus of a CacheLocality.
+ *
+ * The cpus are grouped into nodes by last-level cache, which is the
+ * socket, and so the NUMA node, on common hosts. The i-th thread goes
+ * to node i % numNodes(), so threads are spread evenly over the nodes,
+ * and is pinned to one cpu of that node (kPinCpu), to all cpus of that
+ * node (kPinCache), or not pinned at all (kNoPin).
+ *
+ * Topologies can be simulated from CacheLocality::uniform(n) by adding
+ * a last cache level, such as 2 caches of n / 2 cpus for 2 sockets.
+ */
+class ThreadTopology {
+ public:
+  enum PinLevel {
+    kNoPin,
+    kPinCpu,
+    kPinCache,
+  };
+
+  explicit ThreadTopology(
+      const CacheLocality& locality = CacheLocality::system(),
+      PinLevel pinLevel = kPinCpu);
+
+  size_t numNodes() const {
+    return nodeCpus_.size();
+  }
+
+  size_t nodeOfCpu(size_t cpu) const {
+    return cpu < nodeByCpu_.size() ? nodeByCpu_[cpu] : 0;
+  }
+
+  size_t nodeOfThread(size_t index) const {
+    return index % numNodes();
+  }
+
+  // cpus the index-th thread is pinned to, empty if not pinned
+  std::vector<int> cpusOfThread(size_t index) const;
+
+  // Pins the calling thread as the index-th thread of the topology.
+  void bindThread(size_t index) const;
+
+  // Node of the calling thread if bound to this topology, otherwise the
+  // node of the cpu it runs on.
+  size_t currentNode() const;
+
+ private:
+  PinLevel pinLevel_;
+  // cpus of each node, in locality order
+  std::vector<std::vector<int>> nodeCpus_;
+  std::vector<size_t> nodeByCpu_;
+};
+
+/**
+ * ThreadFactory binding its threads to a ThreadTopology in the order
+ * they are created.
+ *
+ * Usage:
+ *
+ *   auto topology = std::make_shared<ThreadTopology>();
+ *   CPUThreadPoolExecutor pool(
+ *       n, make_unique<NodeTaskQueue>(topology),
+ *       std::make_shared<TopologyThreadFactory>("CPUThreadPool", topology));
+ *
+ *   IOThreadPoolExecutor ioPool(
+ *       n, std::make_shared<TopologyThreadFactory>("IOThreadPool", topology));
+ */
+class TopologyThreadFactory : public ThreadFactory {
+ public:
+  TopologyThreadFactory(StringPiece prefix,
+                        std::shared_ptr<const ThreadTopology> topology)
+    : ThreadFactory(prefix), topology_(std::move(topology)) {}
+
+  std::thread newThread(VoidFunc&& func) override {
+    size_t index = index_++;
+    auto topology = topology_;
+    auto fnw = makeMoveWrapper(std::move(func));
+    return ThreadFactory::newThread(
+        [topology, index, fnw] () {
+          topology->bindThread(index);
+          (*fnw)();
+        });
+  }
+
+  const std::shared_ptr<const ThreadTopology>& topology() const {
+    return topology_;
+  }
+
+ private:
+  std::shared_ptr<const ThreadTopology> topology_;
+  std::atomic<size_t> index_{0};
+};
+
+} // namespace acc
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/concurrency/WorkStealingTaskQueue.h"
+
+#include <thread>
+
+#include "accelerator/Random.h"
+
+namespace acc {
+
+namespace {
+
+std::atomic<uint64_t> nextQueueId(1);
+
+} // namespace
+
+thread_local WorkStealingTaskQueue::LocalWorker
+  WorkStealingTaskQueue::localWorker_;
+
+void WorkStealingTaskQueue::LocalWorker::release() {
+  if (deque) {
+    if (!deque->shared) {
+      deque->live.store(false, std::memory_order_release);
+    }
+    deque.reset();
+  }
+  queueId = 0;
+}
+
+void WorkStealingTaskQueue::Deque::pushBack(CPUTask&& task) {
+  std::lock_guard<std::mutex> guard(lock);
+  tasks.push_back(std::move(task));
+  size.fetch_add(1, std::memory_order_release);
+}
+
+size_t WorkStealingTaskQueue::Deque::pushBack(std::vector<CPUTask>& items) {
+  size_t n = 0;
+  std::lock_guard<std::mutex> guard(lock);
+  for (auto& task : items) {
+    if (!task.poison) {
+      tasks.push_back(std::move(task));
+      n++;
+    }
+  }
+  size.fetch_add(n, std::memory_order_release);
+  return n;
+}
+
+bool WorkStealingTaskQueue::Deque::popBack(CPUTask& task) {
+  if (size.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  if (tasks.empty()) {
+    return false;
+  }
+  task = std::move(tasks.back());
+  tasks.pop_back();
+  size.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool WorkStealingTaskQueue::Deque::popFront(CPUTask& task) {
+  if (size.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  if (tasks.empty()) {
+    return false;
+  }
+  task = std::move(tasks.front());
+  tasks.pop_front();
+  size.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+WorkStealingTaskQueue::WorkStealingTaskQueue()
+  : id_(nextQueueId++), numDeques_(1) {
+  // deque 0 takes tasks added before any worker starts
+  owners_[0].reset(new Deque());
+  owners_[0]->live = true;
+  owners_[0]->shared = true;
+  deques_[0] = owners_[0].get();
+  for (size_t i = 1; i < kMaxDeques; i++) {
+    deques_[i] = nullptr;
+  }
+}
+
+// the workers have exited, or keep their deques alive
+WorkStealingTaskQueue::~WorkStealingTaskQueue() {}
+
+void WorkStealingTaskQueue::add(CPUTask item) {
+  if (item.poison) {
+    poisons_++;
+    sem_.post();
+    return;
+  }
+  addDeque()->pushBack(std::move(item));
+  size_++;
+  sem_.post();
+}
+
+size_t WorkStealingTaskQueue::addBatch(std::vector<CPUTask>& items) {
+  size_t n = addDeque()->pushBack(items);
+  size_ += n;
+  poisons_ += items.size() - n;
+  sem_.post(items.size());
+  return items.size();
+}
+
+WorkStealingTaskQueue::CPUTask WorkStealingTaskQueue::take() {
+  // each permit matches one added task or poison
+  sem_.wait();
+  Deque* local = localDeque();
+  if (!local) {
+    local = registerWorker();
+  }
+  CPUTask task;
+  while (true) {
+    if (local->popBack(task) || steal(task, local)) {
+      size_--;
+      return task;
+    }
+    size_t p = poisons_.load();
+    while (p > 0) {
+      if (poisons_.compare_exchange_weak(p, p - 1)) {
+        return CPUTask();
+      }
+    }
+    // the task of our permit is being pushed
+    std::this_thread::yield();
+  }
+}
+
+size_t WorkStealingTaskQueue::size() {
+  return size_;
+}
+
+WorkStealingTaskQueue::Deque* WorkStealingTaskQueue::localDeque() const {
+  return localWorker_.queueId == id_ ? localWorker_.deque.get() : nullptr;
+}
+
+WorkStealingTaskQueue::Deque* WorkStealingTaskQueue::addDeque() const {
+  Deque* d = localDeque();
+  if (d) {
+    return d;
+  }
+  // the first live deque from a random one
+  size_t n = std::min(numDeques_.load(std::memory_order_acquire), kMaxDeques);
+  size_t start = Random::rand32(0, n);
+  for (size_t k = 0; k < n; k++) {
+    d = deques_[(start + k) % n].load(std::memory_order_acquire);
+    if (d && d->live.load(std::memory_order_acquire)) {
+      return d;
+    }
+  }
+  return deques_[0].load(std::memory_order_relaxed);
+}
+
+WorkStealingTaskQueue::Deque* WorkStealingTaskQueue::registerWorker() {
+  // a thread registers with one queue at a time
+  localWorker_.release();
+  size_t n = std::min(numDeques_.load(std::memory_order_acquire), kMaxDeques);
+  size_t i = 1;
+  for (; i < n; i++) {
+    Deque* d = deques_[i].load(std::memory_order_acquire);
+    bool live = false;
+    if (d && d->live.compare_exchange_strong(live, true)) {
+      break;
+    }
+  }
+  if (i == n) {
+    i = numDeques_.fetch_add(1);
+    if (i < kMaxDeques) {
+      owners_[i].reset(new Deque());
+      owners_[i]->live = true;
+      deques_[i].store(owners_[i].get(), std::memory_order_release);
+    } else {
+      numDeques_.fetch_sub(1);
+      i = 0;
+    }
+  }
+  localWorker_.queueId = id_;
+  localWorker_.deque = owners_[i];
+  return localWorker_.deque.get();
+}
+
+bool WorkStealingTaskQueue::steal(CPUTask& task, Deque* local) {
+  size_t n = std::min(numDeques_.load(std::memory_order_acquire), kMaxDeques);
+  size_t start = Random::rand32(0, n);
+  for (size_t k = 0; k < n; k++) {
+    Deque* d = deques_[(start + k) % n].load(std::memory_order_acquire);
+    if (d && d != local && d->popFront(task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace acc
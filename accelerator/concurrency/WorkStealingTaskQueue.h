@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/thread/BlockingQueue.h"
+#include "accelerator/thread/LifoSem.h"
+
+namespace acc {
+
+/**
+ * Task queue of CPUThreadPoolExecutor with one deque per worker.
+ *
+ * Tasks added by a worker go to the back of its own deque, which it pops
+ * LIFO for the locality of fork/join workloads, other tasks go to the
+ * deque of a random worker. A worker without local tasks steals from the
+ * front of the deques of random victims. The deque of an exited worker
+ * is left to steal from, and reused by the next worker.
+ *
+ * Poison tasks of stopping threads are only taken when no task is left,
+ * so stop() still runs all outstanding tasks.
+ *
+ * Usage:
+ *
+ *   CPUThreadPoolExecutor pool(n, make_unique<WorkStealingTaskQueue>());
+ */
+class WorkStealingTaskQueue
+    : public BlockingQueue<CPUThreadPoolExecutor::CPUTask> {
+ public:
+  typedef CPUThreadPoolExecutor::CPUTask CPUTask;
+
+  // live workers beyond it share one deque
+  static constexpr size_t kMaxDeques = 1024;
+
+  WorkStealingTaskQueue();
+  ~WorkStealingTaskQueue() override;
+
+  void add(CPUTask item) override;
+  // tasks go to one deque, other workers steal from it
+  size_t addBatch(std::vector<CPUTask>& items) override;
+  CPUTask take() override;
+  size_t size() override;
+
+ private:
+  struct ACC_ALIGN_TO_AVOID_FALSE_SHARING Deque {
+    std::mutex lock;
+    std::deque<CPUTask> tasks;
+    std::atomic<size_t> size{0};
+    // owned by a running worker, or deque 0 which is shared
+    std::atomic<bool> live{false};
+    bool shared{false};
+
+    void pushBack(CPUTask&& task);
+    size_t pushBack(std::vector<CPUTask>& items);
+    bool popBack(CPUTask& task);
+    bool popFront(CPUTask& task);
+  };
+
+  // the deque of the calling worker, released when the thread exits
+  struct LocalWorker {
+    uint64_t queueId{0};
+    std::shared_ptr<Deque> deque;
+
+    ~LocalWorker() {
+      release();
+    }
+
+    void release();
+  };
+
+  static thread_local LocalWorker localWorker_;
+
+  Deque* localDeque() const;
+  Deque* addDeque() const;
+  Deque* registerWorker();
+  bool steal(CPUTask& task, Deque* local);
+
+  const uint64_t id_;
+  std::atomic<Deque*> deques_[kMaxDeques];
+  // owners of deques_, shared with the workers
+  std::shared_ptr<Deque> owners_[kMaxDeques];
+  std::atomic<size_t> numDeques_;
+  std::atomic<size_t> size_{0};
+  std::atomic<size_t> poisons_{0};
+  LifoSem sem_;
+};
+
+} // namespace acc
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2017 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/concurrency/Future.h"
+
+using namespace acc;
+
+TEST(Future, ready) {
+  auto future = makeFuture(21);
+  EXPECT_TRUE(future.isReady());
+  auto doubled = future.then([](int v) { return v * 2; });
+  EXPECT_FALSE(future.valid());
+  EXPECT_TRUE(doubled.isReady());
+  EXPECT_EQ(42, doubled.get());
+}
+
+TEST(Future, promise) {
+  Promise<int> promise;
+  std::thread::id ran;
+  auto future = promise.getFuture().then([&](int v) {
+    ran = std::this_thread::get_id();
+    return std::to_string(v);
+  });
+  EXPECT_FALSE(future.isReady());
+  std::thread([&]() { promise.setValue(7); }).join();
+  EXPECT_TRUE(future.isReady());
+  EXPECT_NE(std::this_thread::get_id(), ran);
+  EXPECT_EQ("7", future.get());
+}
+
+TEST(Future, exception) {
+  Promise<int> promise;
+  bool skipped = true;
+  auto future = promise.getFuture()
+    .then([](int) -> int { throw std::logic_error("then"); })
+    .then([&](int v) { skipped = false; return v; });
+  promise.setValue(1);
+  EXPECT_TRUE(skipped);
+  EXPECT_THROW(future.get(), std::logic_error);
+
+  auto failed = makeFuture<int>(
+      std::make_exception_ptr(std::runtime_error("failed")));
+  EXPECT_TRUE(failed.getTry().hasException());
+}
+
+TEST(Future, brokenPromise) {
+  Future<int> future;
+  {
+    Promise<int> promise;
+    future = promise.getFuture();
+  }
+  EXPECT_THROW(future.get(), BrokenPromise);
+}
+
+TEST(Future, thenExecutor) {
+  CPUThreadPoolExecutor pool(2);
+  Promise<int> promise;
+  std::atomic<int> steps(0);
+  auto future = promise.getFuture()
+    .then(&pool, [&](int v) { steps++; return v + 1; })
+    .then(&pool, [&](int v) { steps++; EXPECT_EQ(2, v); });
+  promise.setValue(1);
+  future.get();
+  EXPECT_EQ(2, steps);
+
+  // a ready value still runs on the executor
+  std::thread::id ran;
+  makeFuture(1).then(&pool, [&](int) {
+    ran = std::this_thread::get_id();
+  }).get();
+  EXPECT_NE(std::this_thread::get_id(), ran);
+  pool.join();
+}
+
+TEST(Future, collectAll) {
+  std::vector<Promise<int>> promises(3);
+  std::vector<Future<int>> futures;
+  for (auto& p : promises) {
+    futures.push_back(p.getFuture());
+  }
+  auto all = collectAll(std::move(futures));
+  promises[2].setValue(2);
+  promises[0].setValue(0);
+  EXPECT_FALSE(all.isReady());
+  promises[1].setException(
+      std::make_exception_ptr(std::runtime_error("one")));
+  auto results = all.get();
+  EXPECT_EQ(3, results.size());
+  EXPECT_EQ(0, results[0].value());
+  EXPECT_TRUE(results[1].hasException());
+  EXPECT_EQ(2, results[2].value());
+
+  EXPECT_TRUE(collectAll(std::vector<Future<int>>()).get().empty());
+}
+
+TEST(Future, collectAny) {
+  std::vector<Promise<int>> promises(3);
+  std::vector<Future<int>> futures;
+  for (auto& p : promises) {
+    futures.push_back(p.getFuture());
+  }
+  auto any = collectAny(std::move(futures));
+  promises[1].setValue(10);
+  promises[0].setValue(0);
+  auto first = any.get();
+  EXPECT_EQ(1, first.first);
+  EXPECT_EQ(10, first.second.value());
+  promises[2].setValue(20);
+}
+
+TEST(Future, within) {
+  EventLoop loop(Poller::kMaxEvents, 1000);
+  std::thread t([&]() { loop.loop(); });
+
+  Promise<int> slow;
+  auto timedOut = slow.getFuture().within(&loop, 10000);
+  EXPECT_THROW(timedOut.get(), FutureTimeout);
+  slow.setValue(1);
+
+  Promise<int> fast;
+  auto inTime = fast.getFuture().within(&loop, 10000000);
+  fast.setValue(2);
+  EXPECT_EQ(2, inTime.get());
+
+  loop.stop();
+  t.join();
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "accelerator/Time.h"
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/concurrency/ScheduledExecutor.h"
+
+using namespace acc;
+
+static void waitFor(const std::atomic<int>& count, int n) {
+  while (count.load(std::memory_order_acquire) < n) {
+    std::this_thread::yield();
+  }
+}
+
+TEST(ScheduledExecutor, schedule) {
+  ScheduledExecutor scheduler;
+  std::vector<int> order;
+  std::atomic<int> done(0);
+  uint64_t start = timestampNow();
+  uint64_t fired = 0;
+  scheduler.schedule([&]() { order.push_back(2); done++; }, 1000000);
+  // earlier than the one the timer sleeps for
+  scheduler.schedule([&]() {
+    order.push_back(1);
+    fired = timePassed(start);
+    done++;
+  }, 10000);
+  waitFor(done, 1);
+  EXPECT_LE(10000, fired);
+  EXPECT_GT(500000, fired);
+  EXPECT_EQ(1, scheduler.pending());
+  scheduler.stop();
+  EXPECT_EQ(0, scheduler.pending());
+  std::vector<int> expected = {1};
+  EXPECT_EQ(expected, order);
+}
+
+TEST(ScheduledExecutor, fixedRate) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(2);
+  ScheduledExecutor scheduler(pool);
+  std::mutex lock;
+  std::vector<uint64_t> times;
+  std::atomic<int> done(0);
+  uint64_t start = timestampNow();
+  auto handle = scheduler.scheduleAtFixedRate([&]() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      times.push_back(timePassed(start));
+    }
+    // longer than the period, runs still keep to the grid
+    std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    done++;
+  }, 0, 10000);
+  waitFor(done, 5);
+  handle.cancel();
+  EXPECT_TRUE(handle.cancelled());
+  scheduler.stop();
+  pool->join();
+  std::lock_guard<std::mutex> guard(lock);
+  for (size_t i = 1; i < times.size(); i++) {
+    // no drift: the i-th run is due at i periods
+    EXPECT_LE(i * 10000, times[i]);
+    EXPECT_GT(i * 10000 + 50000, times[i]);
+  }
+}
+
+TEST(ScheduledExecutor, fixedDelay) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(2);
+  ScheduledExecutor scheduler(pool);
+  std::atomic<int> running(0);
+  std::atomic<bool> overlapped(false);
+  std::atomic<int> done(0);
+  std::vector<uint64_t> ends;
+  std::vector<uint64_t> starts;
+  scheduler.scheduleWithFixedDelay([&]() {
+    if (running.fetch_add(1) != 0) {
+      overlapped = true;
+    }
+    starts.push_back(timestampNow());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ends.push_back(timestampNow());
+    running.fetch_sub(1);
+    done++;
+  }, 0, 5000, 1000);
+  waitFor(done, 4);
+  scheduler.stop();
+  pool->join();
+  EXPECT_FALSE(overlapped);
+  for (size_t i = 1; i < starts.size(); i++) {
+    EXPECT_LE(ends[i - 1] + 5000, starts[i]);
+  }
+}
+
+TEST(ScheduledExecutor, cancel) {
+  ScheduledExecutor scheduler;
+  std::atomic<int> done(0);
+  auto handle = scheduler.schedule([&]() { done++; }, 10000);
+  EXPECT_TRUE(handle);
+  EXPECT_FALSE(handle.cancelled());
+  handle.cancel();
+  scheduler.schedule([&]() { done += 10; }, 20000);
+  waitFor(done, 10);
+  EXPECT_EQ(10, done);
+  EXPECT_FALSE(ScheduledExecutor::Handle());
+}
+
+TEST(ScheduledExecutor, compact) {
+  ScheduledExecutor scheduler;
+  std::vector<ScheduledExecutor::Handle> handles;
+  for (int i = 0; i < 100; i++) {
+    handles.push_back(scheduler.schedule([]() {}, 10000000));
+  }
+  for (int i = 0; i < 49; i++) {
+    handles[i].cancel();
+  }
+  EXPECT_EQ(100, scheduler.pending());
+  // half of them cancelled
+  handles[49].cancel();
+  EXPECT_EQ(50, scheduler.pending());
+  handles[49].cancel();
+  EXPECT_EQ(50, scheduler.pending());
+  for (int i = 50; i < 100; i++) {
+    handles[i].cancel();
+  }
+  EXPECT_EQ(0, scheduler.pending());
+}
+
+TEST(ScheduledExecutor, scheduleAfterStop) {
+  ScheduledExecutor scheduler;
+  scheduler.stop();
+  EXPECT_FALSE(scheduler.schedule([]() {}, 0));
+  EXPECT_FALSE(scheduler.scheduleAtFixedRate([]() {}, 0, 1000));
+  EXPECT_FALSE(scheduler.scheduleWithFixedDelay([]() {}, 0, 1000));
+  EXPECT_EQ(0, scheduler.pending());
+}
+
+namespace {
+
+// rejects its first adds, then runs inline
+class RejectingExecutor : public Executor {
+ public:
+  explicit RejectingExecutor(int rejects) : rejects_(rejects) {}
+
+  void add(VoidFunc func) override {
+    if (rejects_-- > 0) {
+      throw std::runtime_error("rejected");
+    }
+    func();
+  }
+
+ private:
+  std::atomic<int> rejects_;
+};
+
+} // namespace
+
+TEST(ScheduledExecutor, executorThrows) {
+  ScheduledExecutor scheduler(std::make_shared<RejectingExecutor>(4));
+  std::atomic<int> once(0);
+  std::atomic<int> rate(0);
+  std::atomic<int> delay(0);
+  scheduler.schedule([&]() { once++; }, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // the rejected runs are skipped, the periodic tasks go on
+  scheduler.scheduleAtFixedRate([&]() { rate++; }, 0, 1000);
+  scheduler.scheduleWithFixedDelay([&]() { delay++; }, 0, 1000);
+  waitFor(rate, 3);
+  waitFor(delay, 3);
+  scheduler.stop();
+  EXPECT_EQ(0, once);
+}
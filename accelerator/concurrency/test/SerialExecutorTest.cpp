@@ -0,0 +1,176 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/concurrency/SerialExecutor.h"
+
+using namespace acc;
+
+static void waitFor(const std::atomic<int>& count, int n) {
+  while (count.load(std::memory_order_acquire) < n) {
+    std::this_thread::yield();
+  }
+}
+
+TEST(SerialExecutor, order) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(4);
+  const int kStrands = 8;
+  const int kProducers = 4;
+  const int kTasks = 1000;
+  std::vector<std::shared_ptr<SerialExecutor>> strands;
+  // per strand and producer, the last task seen
+  std::vector<std::vector<int>> last(kStrands, std::vector<int>(kProducers));
+  std::vector<std::unique_ptr<std::atomic<int>>> running;
+  for (int i = 0; i < kStrands; i++) {
+    strands.push_back(SerialExecutor::create(pool));
+    running.emplace_back(new std::atomic<int>(0));
+  }
+  std::atomic<int> done(0);
+  std::atomic<bool> ordered(true);
+  std::atomic<bool> overlapped(false);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&, p]() {
+      for (int t = 1; t <= kTasks; t++) {
+        int s = t % kStrands;
+        strands[s]->add([&, s, p, t]() {
+          if (running[s]->fetch_add(1) != 0) {
+            overlapped = true;
+          }
+          if (last[s][p] >= t) {
+            ordered = false;
+          }
+          last[s][p] = t;
+          running[s]->fetch_sub(1);
+          done++;
+        });
+      }
+    });
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  waitFor(done, kProducers * kTasks);
+  EXPECT_TRUE(ordered);
+  EXPECT_FALSE(overlapped);
+  pool->join();
+}
+
+TEST(SerialExecutor, batch) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(2);
+  auto strand = SerialExecutor::create(pool);
+  std::vector<int> order;
+  std::atomic<int> done(0);
+  strand->add([&]() { order.push_back(0); done++; });
+  std::vector<VoidFunc> funcs;
+  for (int i = 1; i <= 10; i++) {
+    funcs.push_back([&, i]() { order.push_back(i); done++; });
+  }
+  strand->addBatch(std::move(funcs));
+  waitFor(done, 11);
+  for (int i = 0; i <= 10; i++) {
+    EXPECT_EQ(i, order[i]);
+  }
+  pool->join();
+}
+
+TEST(SerialExecutor, exception) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+  auto strand = SerialExecutor::create(pool);
+  std::atomic<int> done(0);
+  strand->add([]() { throw std::runtime_error("serial"); });
+  strand->add([&]() { done++; });
+  waitFor(done, 1);
+  pool->join();
+}
+
+TEST(SerialExecutor, lifetime) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+  std::atomic<int> done(0);
+  std::weak_ptr<SerialExecutor> weak;
+  {
+    auto strand = SerialExecutor::create(pool);
+    weak = strand;
+    for (int i = 0; i < 100; i++) {
+      strand->add([&]() { done++; });
+    }
+  }
+  // kept alive by its pending tasks
+  waitFor(done, 100);
+  pool->join();
+  EXPECT_TRUE(weak.expired());
+}
+
+namespace {
+
+// runs inline, or throws when failing
+class FlakyExecutor : public Executor {
+ public:
+  void add(VoidFunc func) override {
+    if (fail) {
+      if (onFail) {
+        onFail();
+      }
+      throw std::runtime_error("flaky");
+    }
+    func();
+  }
+
+  bool fail{true};
+  // called before throwing, as an add racing with the failure
+  VoidFunc onFail;
+};
+
+} // namespace
+
+TEST(SerialExecutor, parentThrows) {
+  auto parent = std::make_shared<FlakyExecutor>();
+  auto strand = SerialExecutor::create(parent);
+  std::atomic<int> done(0);
+  EXPECT_THROW(strand->add([&]() { done++; }), std::runtime_error);
+  // the dropped task is not run, and the strand is scheduled again
+  parent->fail = false;
+  strand->add([&]() { done += 10; });
+  EXPECT_EQ(10, done);
+  strand->add([&]() { done += 10; });
+  EXPECT_EQ(20, done);
+}
+
+TEST(SerialExecutor, parentThrowsWithAdd) {
+  auto parent = std::make_shared<FlakyExecutor>();
+  auto strand = SerialExecutor::create(parent);
+  std::atomic<int> done(0);
+  bool raced = false;
+  parent->onFail = [&]() {
+    if (!raced) {
+      raced = true;
+      // sees pending_ non-zero and does not schedule
+      strand->add([&]() { done++; });
+    }
+  };
+  EXPECT_THROW(strand->add([&]() { done++; }), std::runtime_error);
+  // both dropped, and the strand is not left counting them
+  parent->fail = false;
+  strand->add([&]() { done += 10; });
+  EXPECT_EQ(10, done);
+}
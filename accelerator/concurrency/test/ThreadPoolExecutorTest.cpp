@@ -14,10 +14,23 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <vector>
+#include <sched.h>
 #include <gtest/gtest.h>
 
 #include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/concurrency/DeadlineTaskQueue.h"
+#include "accelerator/concurrency/IOThreadPoolExecutor.h"
+#include "accelerator/concurrency/NodeTaskQueue.h"
+#include "accelerator/concurrency/PriorityTaskQueue.h"
+#include "accelerator/concurrency/ThreadPoolSizer.h"
+#include "accelerator/concurrency/ThreadTopology.h"
+#include "accelerator/concurrency/WorkStealingTaskQueue.h"
 
 using namespace acc;
 
@@ -129,6 +142,45 @@ TEST(ThreadPoolTest, IOJoin) {
 }
 */
 
+static std::unique_ptr<CPUThreadPoolExecutor> workStealingPool(size_t n) {
+  return make_unique<CPUThreadPoolExecutor>(
+      n, make_unique<WorkStealingTaskQueue>());
+}
+
+template <class Pool>
+static void addBatch(Pool& pool) {
+  std::atomic<int> completed(0);
+  for (size_t n : {0, 1, 16, 256}) {
+    std::vector<VoidFunc> funcs;
+    for (size_t i = 0; i < n; i++) {
+      funcs.push_back([&]() { completed++; });
+    }
+    pool.addBatch(std::move(funcs));
+  }
+  pool.join();
+  EXPECT_EQ(273, completed);
+}
+
+TEST(ThreadPoolTest, CPUAddBatch) {
+  CPUThreadPoolExecutor pool(4);
+  addBatch(pool);
+}
+
+TEST(ThreadPoolTest, IOAddBatch) {
+  IOThreadPoolExecutor pool(4);
+  addBatch(pool);
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingAddBatch) {
+  auto pool = workStealingPool(4);
+  addBatch(*pool);
+}
+
+TEST(ThreadPoolTest, CPUPriorityAddBatch) {
+  CPUThreadPoolExecutor pool(4, make_unique<PriorityTaskQueue>(3));
+  addBatch(pool);
+}
+
 template <class Pool>
 static void resizeUnderLoad() {
   Pool pool(10);
@@ -295,3 +347,589 @@ TEST(ThreadPoolTest, IOObserver) {
 }
 */
 
+
+static void pickPolicy(IOThreadPoolExecutor::PickPolicy policy) {
+  IOThreadPoolExecutor pool(4, std::make_shared<ThreadFactory>("IOThreadPool"),
+                            EventLoopManager::get(), policy);
+  EXPECT_EQ(policy, pool.getPickPolicy());
+  std::atomic<int> completed(0);
+  for (int i = 0; i < 100; i++) {
+    pool.add([&]() { completed++; });
+  }
+  pool.join();
+  EXPECT_EQ(100, completed);
+}
+
+TEST(ThreadPoolTest, IOPickRoundRobin) {
+  pickPolicy(IOThreadPoolExecutor::kRoundRobin);
+}
+
+TEST(ThreadPoolTest, IOPickTwoChoices) {
+  pickPolicy(IOThreadPoolExecutor::kTwoChoices);
+}
+
+TEST(ThreadPoolTest, IOPickLeastLoaded) {
+  pickPolicy(IOThreadPoolExecutor::kLeastLoaded);
+}
+
+TEST(ThreadPoolTest, IOAddWithKey) {
+  IOThreadPoolExecutor pool(4);
+  std::mutex lock;
+  std::map<uint64_t, std::set<std::thread::id>> threads;
+  for (int i = 0; i < 100; i++) {
+    uint64_t key = i % 8;
+    pool.addWithKey(key, [&, key]() {
+      std::lock_guard<std::mutex> guard(lock);
+      threads[key].insert(std::this_thread::get_id());
+    });
+  }
+  pool.join();
+  EXPECT_EQ(8, threads.size());
+  for (auto& kv : threads) {
+    EXPECT_EQ(1, kv.second.size());
+  }
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingStop) {
+  auto pool = workStealingPool(1);
+  std::atomic<int> completed(0);
+  for (int i = 0; i < 1000; i++) {
+    pool->add([&]() {
+      burnMs(10)();
+      completed++;
+    });
+  }
+  pool->stop();
+  EXPECT_GT(1000, completed);
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingJoin) {
+  auto pool = workStealingPool(10);
+  std::atomic<int> completed(0);
+  for (int i = 0; i < 1000; i++) {
+    pool->add([&]() {
+      burnMs(1)();
+      completed++;
+    });
+  }
+  pool->join();
+  EXPECT_EQ(1000, completed);
+  EXPECT_EQ(0, pool->getPendingTaskCount());
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingForkJoin) {
+  auto pool = workStealingPool(4);
+  std::atomic<int> completed(0);
+  std::function<void(int)> fork = [&](int depth) {
+    completed++;
+    if (depth > 0) {
+      pool->add([&, depth]() { fork(depth - 1); });
+      pool->add([&, depth]() { fork(depth - 1); });
+    }
+  };
+  pool->add([&]() { fork(9); });
+  // workers spawn the whole tree before join() poisons them
+  while (completed < 1023) {
+    std::this_thread::yield();
+  }
+  pool->join();
+  EXPECT_EQ(1023, completed);
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingResize) {
+  auto pool = workStealingPool(4);
+  std::atomic<int> completed(0);
+  for (int round = 0; round < 100; round++) {
+    // children land in the deques of workers about to exit
+    for (int i = 0; i < 10; i++) {
+      pool->add([&]() {
+        completed++;
+        pool->add([&]() { completed++; });
+      });
+    }
+    pool->setNumThreads(1);
+    pool->setNumThreads(4);
+  }
+  pool->join();
+  EXPECT_EQ(2000, completed);
+}
+
+TEST(ThreadPoolTest, CPUWorkStealingExpiration) {
+  auto pool = workStealingPool(1);
+  std::atomic<int> expired(0);
+  pool->add(burnMs(10));
+  pool->add(burnMs(10), 1000, [&]() { expired++; });
+  pool->join();
+  EXPECT_EQ(1, expired);
+}
+
+TEST(ThreadPoolTest, PriorityLanes) {
+  PriorityTaskQueue three(3);
+  EXPECT_EQ(3, three.getNumPriorities());
+  EXPECT_EQ(0, three.lane(Executor::LO_PRI));
+  EXPECT_EQ(0, three.lane(-1));
+  EXPECT_EQ(1, three.lane(Executor::MID_PRI));
+  EXPECT_EQ(2, three.lane(1));
+  EXPECT_EQ(2, three.lane(Executor::HI_PRI));
+  PriorityTaskQueue one(1);
+  EXPECT_EQ(0, one.lane(Executor::LO_PRI));
+  EXPECT_EQ(0, one.lane(Executor::HI_PRI));
+}
+
+// runs one blocking task, then the tasks of priorities in take order
+static std::vector<int8_t> runPriorities(
+    size_t starvationInterval,
+    const std::vector<int8_t>& priorities) {
+  CPUThreadPoolExecutor pool(
+      1, make_unique<PriorityTaskQueue>(
+          3, CPUThreadPoolExecutor::kDefaultMaxQueueSize,
+          starvationInterval));
+  EXPECT_EQ(3, pool.getNumPriorities());
+  std::mutex lock;
+  std::vector<int8_t> order, stats;
+  pool.subscribeToTaskStats([&](ThreadPoolExecutor::TaskStats s) {
+    std::lock_guard<std::mutex> guard(lock);
+    stats.push_back(s.priority);
+  });
+  Baton started;
+  std::atomic<bool> blocked(true);
+  pool.add([&]() {
+    started.post();
+    while (blocked) {
+      std::this_thread::yield();
+    }
+  });
+  started.wait();
+  for (auto p : priorities) {
+    pool.addWithPriority([&, p]() {
+      std::lock_guard<std::mutex> guard(lock);
+      order.push_back(p);
+    }, p);
+  }
+  EXPECT_EQ(priorities.size(), pool.getPendingTaskCount());
+  blocked = false;
+  pool.join();
+  EXPECT_EQ(priorities.size() + 1, stats.size());
+  stats.erase(stats.begin());
+  EXPECT_EQ(order, stats);
+  return order;
+}
+
+TEST(ThreadPoolTest, CPUPriority) {
+  auto order = runPriorities(
+      0, {Executor::LO_PRI, Executor::MID_PRI, Executor::HI_PRI,
+          Executor::LO_PRI, Executor::HI_PRI});
+  std::vector<int8_t> expected = {
+    Executor::HI_PRI, Executor::HI_PRI, Executor::MID_PRI,
+    Executor::LO_PRI, Executor::LO_PRI};
+  EXPECT_EQ(expected, order);
+}
+
+TEST(ThreadPoolTest, CPUPriorityStarvation) {
+  // the blocking task is the first take, every 2nd take is starved
+  auto order = runPriorities(
+      2, {Executor::LO_PRI, Executor::HI_PRI, Executor::HI_PRI,
+          Executor::HI_PRI});
+  std::vector<int8_t> expected = {
+    Executor::LO_PRI, Executor::HI_PRI, Executor::HI_PRI,
+    Executor::HI_PRI};
+  EXPECT_EQ(expected, order);
+}
+
+// a pool of 1 thread busy with a blocking task, and a queue of 2 tasks
+class FullPool {
+ public:
+  FullPool() : pool(1, 2) {
+    pool.add([&]() {
+      started.post();
+      while (blocked) {
+        std::this_thread::yield();
+      }
+    });
+    started.wait();
+  }
+
+  ~FullPool() {
+    release();
+    pool.join();
+  }
+
+  void fill(uint64_t expiration = 0, VoidFunc expireCallback = nullptr) {
+    for (int i = 0; i < 2; i++) {
+      EXPECT_TRUE(pool.tryAdd([&]() { completed++; },
+                              expiration, expireCallback));
+    }
+  }
+
+  void release() {
+    blocked = false;
+  }
+
+  CPUThreadPoolExecutor pool;
+  std::atomic<int> completed{0};
+
+ private:
+  Baton started;
+  std::atomic<bool> blocked{true};
+};
+
+TEST(ThreadPoolTest, CPUTryAdd) {
+  FullPool full;
+  full.fill();
+  EXPECT_FALSE(full.pool.tryAdd([]() {}));
+  EXPECT_THROW(full.pool.add([]() {}), std::runtime_error);
+  auto stats = full.pool.getPoolStats();
+  EXPECT_EQ(2, stats.maxPendingTaskCount);
+  EXPECT_EQ(0, stats.rejectedTaskCount);
+}
+
+TEST(ThreadPoolTest, CPUOverflowReject) {
+  FullPool full;
+  int rejected = 0;
+  full.pool.setOverflowPolicy(CPUThreadPoolExecutor::kReject);
+  full.pool.setRejectCallback([&](VoidFunc func) {
+    rejected++;
+    func();
+  });
+  full.fill();
+  full.pool.add([&]() { full.completed++; });
+  EXPECT_EQ(1, rejected);
+  EXPECT_EQ(1, full.completed);
+  EXPECT_EQ(1, full.pool.getPoolStats().rejectedTaskCount);
+}
+
+TEST(ThreadPoolTest, CPUOverflowBlock) {
+  FullPool full;
+  full.pool.setOverflowPolicy(CPUThreadPoolExecutor::kBlock, 10000);
+  full.fill();
+  uint64_t start = timestampNow();
+  full.pool.add([&]() { full.completed++; });
+  EXPECT_LE(10000, timePassed(start));
+  EXPECT_EQ(1, full.pool.getPoolStats().rejectedTaskCount);
+
+  // without timeout until the queue has room
+  full.pool.setOverflowPolicy(CPUThreadPoolExecutor::kBlock);
+  std::thread releaser([&]() {
+    usleep(10000);
+    full.release();
+  });
+  full.pool.add([&]() { full.completed++; });
+  releaser.join();
+  full.pool.join();
+  EXPECT_EQ(3, full.completed);
+}
+
+TEST(ThreadPoolTest, CPUOverflowCallerRuns) {
+  FullPool full;
+  full.pool.setOverflowPolicy(CPUThreadPoolExecutor::kCallerRuns);
+  full.fill();
+  std::thread::id runner;
+  full.pool.add([&]() { runner = std::this_thread::get_id(); });
+  EXPECT_EQ(std::this_thread::get_id(), runner);
+
+  // guarded and counted as on a pool thread
+  EXPECT_NO_THROW(full.pool.add([]() { throw std::runtime_error("x"); }));
+  full.pool.add([]() {}, 1000);
+  EXPECT_EQ(1, full.pool.getPoolStats().deadlineTaskCount);
+}
+
+TEST(ThreadPoolTest, CPUOverflowDropOldestExpired) {
+  FullPool full;
+  full.pool.setOverflowPolicy(CPUThreadPoolExecutor::kDropOldestExpired);
+  std::atomic<int> expired(0);
+  full.fill(1000, [&]() { expired++; });
+  usleep(2000);
+  std::mutex lock;
+  std::vector<int> order;
+  auto record = [&](int id) {
+    return [&, id]() {
+      std::lock_guard<std::mutex> guard(lock);
+      order.push_back(id);
+    };
+  };
+  full.pool.add(record(1));
+  EXPECT_EQ(1, expired);
+  EXPECT_EQ(0, full.pool.getPoolStats().rejectedTaskCount);
+
+  // drops the other expired task, then the oldest is alive and is kept
+  // first, the new task is rejected
+  full.pool.add(record(2), 60000000);
+  EXPECT_EQ(2, expired);
+  full.pool.add(record(3));
+  full.pool.add(record(4));
+  EXPECT_EQ(2, full.pool.getPoolStats().rejectedTaskCount);
+  EXPECT_EQ(2, full.pool.getPoolStats().expiredTaskCount);
+  full.release();
+  full.pool.join();
+  EXPECT_EQ(2, expired);
+  EXPECT_EQ((std::vector<int>{1, 2}), order);
+}
+
+// a pool of 1 thread with an EDF queue, busy with a blocking task
+class BlockedDeadlinePool {
+ public:
+  explicit BlockedDeadlinePool(uint64_t hopelessMargin = 0)
+    : pool(1, make_unique<DeadlineTaskQueue>(1000000, hopelessMargin)) {
+    pool.add([&]() {
+      started.post();
+      while (blocked) {
+        std::this_thread::yield();
+      }
+    });
+    started.wait();
+  }
+
+  void add(int id, uint64_t expiration, VoidFunc expireCallback = nullptr) {
+    pool.add([&, id]() {
+      std::lock_guard<std::mutex> guard(lock);
+      order.push_back(id);
+    }, expiration, std::move(expireCallback));
+  }
+
+  void run() {
+    blocked = false;
+    pool.join();
+  }
+
+  CPUThreadPoolExecutor pool;
+  std::mutex lock;
+  std::vector<int> order;
+  Baton started;
+  std::atomic<bool> blocked{true};
+};
+
+TEST(ThreadPoolTest, CPUDeadline) {
+  BlockedDeadlinePool edf;
+  // no expiration is 1s of slack
+  edf.add(0, 0);
+  edf.add(1, 60000000);
+  edf.add(2, 30000000);
+  edf.add(3, 500000);
+  edf.add(4, 30000000);
+  edf.run();
+  std::vector<int> expected = {3, 0, 2, 4, 1};
+  EXPECT_EQ(expected, edf.order);
+  auto stats = edf.pool.getPoolStats();
+  EXPECT_EQ(4, stats.deadlineTaskCount);
+  EXPECT_EQ(0, stats.expiredTaskCount);
+  EXPECT_EQ(0, stats.missedDeadlineCount);
+}
+
+TEST(ThreadPoolTest, CPUDeadlineHopeless) {
+  // tasks due within 10s of being taken cannot make it
+  BlockedDeadlinePool edf(10000000);
+  std::atomic<int> expired(0);
+  edf.add(0, 5000000, [&]() { expired++; });
+  edf.add(1, 60000000, [&]() { expired++; });
+  edf.add(2, 1000, [&]() { expired++; });
+  usleep(2000);
+  edf.run();
+  EXPECT_EQ(2, expired);
+  std::vector<int> expected = {1};
+  EXPECT_EQ(expected, edf.order);
+  auto stats = edf.pool.getPoolStats();
+  EXPECT_EQ(3, stats.deadlineTaskCount);
+  EXPECT_EQ(2, stats.expiredTaskCount);
+}
+
+TEST(ThreadPoolTest, CPUMissedDeadline) {
+  CPUThreadPoolExecutor pool(1);
+  std::atomic<int> missed(0);
+  pool.subscribeToTaskStats([&](ThreadPoolExecutor::TaskStats s) {
+    if (s.missedDeadline) {
+      missed++;
+    }
+  });
+  pool.add(burnMs(5), 1000);
+  pool.add(burnMs(1), 60000000);
+  pool.join();
+  EXPECT_EQ(1, missed);
+  auto stats = pool.getPoolStats();
+  EXPECT_EQ(2, stats.deadlineTaskCount);
+  EXPECT_EQ(0, stats.expiredTaskCount);
+  EXPECT_EQ(1, stats.missedDeadlineCount);
+}
+
+// 8 cpus in 2 sockets of 4
+static CacheLocality twoSockets() {
+  auto locality = CacheLocality::uniform(8);
+  locality.numCachesByLevel.push_back(2);
+  return locality;
+}
+
+TEST(ThreadPoolTest, ThreadTopology) {
+  ThreadTopology byCpu(twoSockets(), ThreadTopology::kPinCpu);
+  EXPECT_EQ(2, byCpu.numNodes());
+  EXPECT_EQ(0, byCpu.nodeOfCpu(3));
+  EXPECT_EQ(1, byCpu.nodeOfCpu(4));
+  EXPECT_EQ(std::vector<int>{0}, byCpu.cpusOfThread(0));
+  EXPECT_EQ(std::vector<int>{4}, byCpu.cpusOfThread(1));
+  EXPECT_EQ(std::vector<int>{1}, byCpu.cpusOfThread(2));
+  EXPECT_EQ(std::vector<int>{0}, byCpu.cpusOfThread(8));
+
+  ThreadTopology byCache(twoSockets(), ThreadTopology::kPinCache);
+  std::vector<int> expected = {4, 5, 6, 7};
+  EXPECT_EQ(expected, byCache.cpusOfThread(1));
+
+  ThreadTopology uniform(CacheLocality::uniform(4), ThreadTopology::kNoPin);
+  EXPECT_EQ(4, uniform.numNodes());
+  EXPECT_TRUE(uniform.cpusOfThread(0).empty());
+}
+
+TEST(ThreadPoolTest, NodeTaskQueue) {
+  auto topology = std::make_shared<ThreadTopology>(
+      twoSockets(), ThreadTopology::kNoPin);
+  NodeTaskQueue queue(topology);
+  std::vector<int> order;
+  auto onNode = [&](size_t node, VoidFunc func) {
+    std::thread([&, node]() {
+      topology->bindThread(node);
+      EXPECT_EQ(node, topology->currentNode());
+      func();
+    }).join();
+  };
+  auto task = [&](int id) {
+    return NodeTaskQueue::CPUTask([&, id]() { order.push_back(id); },
+                                  0, nullptr);
+  };
+  onNode(1, [&]() { queue.add(task(1)); });
+  onNode(0, [&]() { queue.add(task(0)); });
+  EXPECT_EQ(2, queue.size());
+  // its own node first, then steals when idle
+  onNode(1, [&]() { queue.take().func_(); });
+  onNode(1, [&]() { queue.take().func_(); });
+  std::vector<int> expected = {1, 0};
+  EXPECT_EQ(expected, order);
+  EXPECT_EQ(1, queue.steals());
+}
+
+TEST(ThreadPoolTest, CPUTopology) {
+  auto topology = std::make_shared<ThreadTopology>(
+      twoSockets(), ThreadTopology::kNoPin);
+  CPUThreadPoolExecutor pool(
+      4, make_unique<NodeTaskQueue>(topology),
+      std::make_shared<TopologyThreadFactory>("CPUThreadPool", topology));
+  std::atomic<int> nodes[2];
+  nodes[0] = nodes[1] = 0;
+  for (int i = 0; i < 100; i++) {
+    pool.add([&]() { nodes[topology->currentNode()]++; });
+  }
+  pool.join();
+  EXPECT_EQ(100, nodes[0] + nodes[1]);
+}
+
+TEST(ThreadPoolTest, IOTopology) {
+  auto topology = std::make_shared<ThreadTopology>(
+      twoSockets(), ThreadTopology::kNoPin);
+  IOThreadPoolExecutor pool(
+      2, std::make_shared<TopologyThreadFactory>("IOThreadPool", topology));
+  std::atomic<int> nodes[2];
+  nodes[0] = nodes[1] = 0;
+  // round-robin over the threads of both nodes
+  for (int i = 0; i < 10; i++) {
+    pool.add([&]() { nodes[topology->currentNode()]++; });
+  }
+  pool.join();
+  EXPECT_EQ(5, nodes[0]);
+  EXPECT_EQ(5, nodes[1]);
+}
+
+TEST(ThreadPoolTest, CPUPinned) {
+  // to all cpus of each node of the host
+  auto topology = std::make_shared<ThreadTopology>(
+      CacheLocality::system(), ThreadTopology::kPinCache);
+  CPUThreadPoolExecutor pool(
+      2, make_unique<NodeTaskQueue>(topology),
+      std::make_shared<TopologyThreadFactory>("CPUThreadPool", topology));
+  std::atomic<int> pinned(0);
+  for (int i = 0; i < 10; i++) {
+    pool.add([&]() {
+      auto cpus = topology->cpusOfThread(topology->currentNode());
+      if (std::find(cpus.begin(), cpus.end(), sched_getcpu()) != cpus.end()) {
+        pinned++;
+      }
+    });
+  }
+  pool.join();
+  EXPECT_EQ(10, pinned);
+}
+
+TEST(ThreadPoolTest, SizerGrow) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+  ThreadPoolSizer::Options options;
+  options.maxThreads = 4;
+  ThreadPoolSizer sizer(pool, options);
+  for (int i = 0; i < 20; i++) {
+    pool->add(burnMs(2));
+  }
+  while (pool->getPendingTaskCount() > 0) {
+    usleep(1000);
+  }
+  usleep(5000);
+  // waited 19ms in the mean for 2ms of run time, so wants 7 threads
+  EXPECT_EQ(4, sizer.update());
+  EXPECT_EQ(4, pool->numThreads());
+  EXPECT_LT(options.targetWaitTime, sizer.lastWaitTime());
+  pool->join();
+}
+
+TEST(ThreadPoolTest, SizerShrink) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(4);
+  ThreadPoolSizer::Options options;
+  options.minThreads = 2;
+  options.maxThreads = 4;
+  options.idleTimeout = 1000;
+  ThreadPoolSizer sizer(pool, options);
+  usleep(2000);
+  EXPECT_EQ(3, sizer.update());
+  EXPECT_EQ(2, sizer.update());
+  EXPECT_EQ(2, sizer.update());
+  EXPECT_EQ(2, pool->numThreads());
+  pool->join();
+}
+
+TEST(ThreadPoolTest, SizerBounds) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+  ThreadPoolSizer::Options options;
+  options.minThreads = 2;
+  options.maxThreads = 3;
+  ThreadPoolSizer sizer(pool, options);
+  EXPECT_EQ(2, sizer.update());
+  std::atomic<int> started(0);
+  std::atomic<bool> blocked(true);
+  for (int i = 0; i < 4; i++) {
+    pool->add([&]() {
+      started++;
+      while (blocked) {
+        usleep(100);
+      }
+    });
+  }
+  // both threads busy
+  while (started < 2) {
+    std::this_thread::yield();
+  }
+  // pending tasks but none done
+  EXPECT_EQ(3, sizer.update());
+  EXPECT_EQ(3, sizer.update());
+  blocked = false;
+  pool->join();
+}
+
+TEST(ThreadPoolTest, SizerStart) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(1);
+  ThreadPoolSizer::Options options;
+  options.maxThreads = 2;
+  options.interval = 1000;
+  ThreadPoolSizer sizer(pool, options);
+  sizer.start();
+  for (int i = 0; i < 20; i++) {
+    pool->add(burnMs(1));
+  }
+  for (int i = 0; i < 1000 && pool->numThreads() < 2; i++) {
+    usleep(1000);
+  }
+  EXPECT_EQ(2, pool->numThreads());
+  sizer.stop();
+  pool->join();
+}
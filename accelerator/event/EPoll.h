@@ -20,32 +20,30 @@
 #include <utility>
 #include <sys/epoll.h>
 
+#include "accelerator/event/Poller.h"
+
 namespace acc {
 
-class EPoll {
+class EPoll : public Poller {
  public:
-  enum : uint32_t {
-    kRead = EPOLLIN,
-    kWrite = EPOLLOUT,
-    kError = EPOLLERR | EPOLLHUP,
-  };
-
   explicit EPoll(int size = kMaxEvents);
 
-  ~EPoll();
+  ~EPoll() override;
 
-  void add(int fd, uint32_t events);
-  void modify(int fd, uint32_t events);
-  void remove(int fd);
+  Type type() const override {
+    return kEPoll;
+  }
 
-  int wait(int timeout);
+  void add(int fd, uint32_t events) override;
+  void modify(int fd, uint32_t events) override;
+  void remove(int fd) override;
 
-  struct epoll_event get(int i) const {
+  int wait(int timeout) override;
+
+  struct epoll_event get(int i) const override {
     return events_[i];
   }
 
-  static constexpr int kMaxEvents = 1024;
-
  private:
   void control(int op, int fd, uint32_t events);
 
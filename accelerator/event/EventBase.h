@@ -16,12 +16,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include "accelerator/Portability.h"
 #include "accelerator/String.h"
 #include "accelerator/Time.h"
+#include "accelerator/TimingWheel.h"
 #include "accelerator/event/EventUtil.h"
+#include "accelerator/thread/AtomicLinkedList.h"
 
 DECLARE_uint64(event_lp_timeout);
 
@@ -118,6 +121,13 @@ class EventBase {
   virtual int fd() const = 0;
   virtual std::string str() const = 0;
 
+  // hook of EventLoop deadline wheel
+  TimingWheelHook<EventBase> timeoutHook;
+  // hook of EventLoop event inbox, queued while linked there: adding an
+  // event already queued is a no-op
+  AtomicIntrusiveLinkedListHook<EventBase> inboxHook;
+  std::atomic<bool> inboxQueued{false};
+
  protected:
   State state_;
   std::vector<Timestamp> timestamps_;
@@ -16,18 +16,31 @@
 
 #include "accelerator/event/EventLoop.h"
 
+#include <algorithm>
+
 #include "accelerator/Logging.h"
+#include "accelerator/MoveWrapper.h"
 #include "accelerator/ScopeGuard.h"
 #include "accelerator/event/EventMonitorKey.h"
 
+DEFINE_uint64(event_stall_budget, 100000,
+              "Report EventLoops busy (not polling) longer than this (us), "
+              "0 to disable.");
+
 namespace acc {
 
-EventLoop::EventLoop(int pollSize, int pollTimeout)
-  : poll_(pollSize),
+EventLoop::EventLoop(int pollSize, int pollTimeout, Poller::Type pollerType)
+  : poll_(Poller::create(pollerType, pollSize)),
     timeout_(pollTimeout),
     stop_(false),
     loopThread_() {
-  poll_.add(waker_.fd(), EPoll::kRead);
+  poll_->add(waker_.fd(), Poller::kRead);
+}
+
+EventLoop::~EventLoop() {
+  events_.sweep([](EventBase* ev) {
+    ev->inboxQueued.store(false, std::memory_order_release);
+  });
 }
 
 void EventLoop::registerHandler(std::unique_ptr<EventHandlerBase> handler) {
@@ -46,71 +59,61 @@ void EventLoop::loopBody(bool once) {
   ACCLOG(V5) << "EventLoop(): Starting loop.";
 
   loopThread_.store(std::this_thread::get_id(), std::memory_order_release);
+  busySince_.store(timestampNow(), std::memory_order_relaxed);
 
   while (!stop_.load(std::memory_order_acquire)) {
     uint64_t t0 = timestampNow();
+    uint64_t t = t0;
 
-    std::vector<EventBase*> events;
-    {
-      std::lock_guard<std::mutex> guard(eventsLock_);
-      events.swap(events_);
-    }
-    for (auto& ev : events) {
+    events_.sweepOnce([&](EventBase* ev) {
+      ev->inboxQueued.store(false, std::memory_order_release);
       ACCLOG(V2) << *ev << " add event";
       pushEvent(ev);
       dispatchEvent(ev);
-    }
+    });
+    setPhase(kCallbackPhase, t);
 
-    std::vector<VoidFunc> callbacks;
-    {
-      std::lock_guard<std::mutex> guard(callbacksLock_);
-      callbacks.swap(callbacks_);
-    }
-    for (auto& cb : callbacks) {
-      cb();
-    }
+    callbacks_.sweepOnce([&](VoidFunc&& cb) {
+      runHandler("callback", -1, cb);
+    });
+    setPhase(kTimeoutPhase, t);
 
     checkTimeoutEvents();
+    checkTimers();
+    setPhase(kWaitPhase, t);
+
+    checkBusy(t);
+    busySince_.store(0, std::memory_order_relaxed);
+    int n = poll_->wait(pollTimeout());
+    busySince_.store(timestampNow(), std::memory_order_relaxed);
+    setPhase(kDispatchPhase, t);
 
-    int n = poll_.wait(timeout_);
     if (n > 0) {
       for (int i = 0; i < n; ++i) {
-        struct epoll_event p = poll_.get(i);
+        struct epoll_event p = poll_->get(i);
         int fd = p.data.fd;
         if (fd == waker_.fd()) {
           waker_.consume();
+        } else if (size_t(fd) < fdWaits_.size() && fdWaits_[fd].callback) {
+          VoidFunc callback = std::move(fdWaits_[fd].callback);
+          fdWaits_[fd].callback = nullptr;
+          firedFds_.push_back(fd);
+          runHandler("fdCallback", fd, callback);
         } else {
-          EventBase* event = fdEvents_[fd];
+          EventBase* event = fdEvent(fd);
           if (event) {
             ACCLOG(V2) << *event << " on event, type=" << p.events;
-            switch (event->state()) {
-              case EventBase::kConnect:
-                handler_->onConnect(event); break;
-              case EventBase::kListen:
-                handler_->onListen(event); break;
-              case EventBase::kNext:
-                restartEvent(event);
-              case EventBase::kToRead:
-              case EventBase::kReading:
-                handler_->onRead(event); break;
-              case EventBase::kToWrite:
-              case EventBase::kWriting:
-                handler_->onWrite(event); break;
-              case EventBase::kTimeout:
-                handler_->onTimeout(event); break;
-              default:
-                ACCLOG(ERROR) << *event << " error event, type=" << p.events;
-                handler_->close(event);
-                break;
-            }
+            dispatchReady(event, p.events);
           }
         }
       }
+      releaseFiredFds();
       ACCMON_ADD(EventMonitorKey, kLoopEvent, n);
       ACCMON_ADD(EventMonitorKey, kLoopEventMax, n);
     }
+    setPhase(kRegisterPhase, t);
 
-    uint64_t cost = timePassed(t0) / 1000;
+    uint64_t cost = (t - t0) / 1000;
     ACCMON_ADD(EventMonitorKey, kLoopCost, cost);
     ACCMON_ADD(EventMonitorKey, kLoopCostMax, cost);
 
@@ -120,55 +123,248 @@ void EventLoop::loopBody(bool once) {
   }
 
   stop_ = false;
+  busySince_.store(0, std::memory_order_relaxed);
 
   loopThread_.store({}, std::memory_order_release);
 }
 
+void EventLoop::dispatchReady(EventBase* event, uint32_t events) {
+  int fd = event->fd();
+  switch (event->state()) {
+    case EventBase::kConnect:
+      runHandler("onConnect", fd, [&]() { handler_->onConnect(event); });
+      break;
+    case EventBase::kListen:
+      runHandler("onListen", fd, [&]() { handler_->onListen(event); });
+      break;
+    case EventBase::kNext:
+      restartEvent(event);
+    case EventBase::kToRead:
+    case EventBase::kReading:
+      runHandler("onRead", fd, [&]() { handler_->onRead(event); });
+      break;
+    case EventBase::kToWrite:
+    case EventBase::kWriting:
+      runHandler("onWrite", fd, [&]() { handler_->onWrite(event); });
+      break;
+    case EventBase::kTimeout:
+      runHandler("onTimeout", fd, [&]() { handler_->onTimeout(event); });
+      break;
+    default:
+      ACCLOG(ERROR) << *event << " error event, type=" << events;
+      runHandler("close", fd, [&]() { handler_->close(event); });
+      break;
+  }
+}
+
+template <class F>
+void EventLoop::runHandler(const char* name, int fd, F&& func) {
+  handlerName_.store(name, std::memory_order_relaxed);
+  handlerFd_.store(fd, std::memory_order_relaxed);
+  func();
+  handlerName_.store(nullptr, std::memory_order_relaxed);
+  if (FLAGS_event_stall_budget > 0) {
+    // chained from the previous handler, one clock read per handler
+    uint64_t now = timestampNow();
+    if (now - handlerStart_ > slowest_.cost) {
+      slowest_ = HandlerCost{name, fd, now - handlerStart_};
+    }
+    handlerStart_ = now;
+  }
+}
+
+void EventLoop::setPhase(Phase next, uint64_t& start) {
+  Phase phase = Phase(phase_.load(std::memory_order_relaxed));
+  uint64_t now = timestampNow();
+  uint64_t cost = now - start;
+  phases_[phase].add(cost);
+  switch (phase) {
+    case kRegisterPhase:
+      ACCMON_ADD(EventMonitorKey, kRegisterCostMax, cost); break;
+    case kCallbackPhase:
+      ACCMON_ADD(EventMonitorKey, kCallbackCostMax, cost); break;
+    case kTimeoutPhase:
+      ACCMON_ADD(EventMonitorKey, kTimeoutCostMax, cost); break;
+    case kWaitPhase:
+      ACCMON_ADD(EventMonitorKey, kWaitCostMax, cost); break;
+    case kDispatchPhase:
+      ACCMON_ADD(EventMonitorKey, kDispatchCostMax, cost); break;
+    default:
+      break;
+  }
+  start = handlerStart_ = now;
+  phase_.store(next, std::memory_order_relaxed);
+}
+
+void EventLoop::checkBusy(uint64_t now) {
+  uint64_t since = busySince_.load(std::memory_order_relaxed);
+  if (FLAGS_event_stall_budget > 0 && since > 0 &&
+      now - since > FLAGS_event_stall_budget) {
+    ACCLOG(WARN) << "EventLoop busy for " << now - since
+      << "us without polling, slowest handler: "
+      << (slowest_.name ? slowest_.name : "none")
+      << "(fd=" << slowest_.fd << ") " << slowest_.cost << "us";
+  }
+  slowest_ = HandlerCost{nullptr, -1, 0};
+}
+
+const char* EventLoop::phaseName(Phase phase) {
+  switch (phase) {
+    case kRegisterPhase: return "register";
+    case kCallbackPhase: return "callback";
+    case kTimeoutPhase: return "timeout";
+    case kWaitPhase: return "wait";
+    case kDispatchPhase: return "dispatch";
+    default: break;
+  }
+  return "unknown";
+}
+
+bool EventLoop::checkStall(uint64_t budget) const {
+  uint64_t since = busySince_.load(std::memory_order_relaxed);
+  if (since == 0) {
+    return false;
+  }
+  uint64_t now = timestampNow();
+  if (now < since || now - since <= budget) {
+    return false;
+  }
+  const char* name = handlerName_.load(std::memory_order_relaxed);
+  ACCLOG(WARN) << "EventLoop stalled for " << now - since
+    << "us in " << phaseName(Phase(phase_.load(std::memory_order_relaxed)))
+    << " phase, running handler: " << (name ? name : "none")
+    << "(fd=" << handlerFd_.load(std::memory_order_relaxed) << ")";
+  return true;
+}
+
 void EventLoop::stop() {
-  poll_.remove(waker_.fd());
   for (auto& fd : listenFds_) {
-    poll_.remove(fd);
+    poll_->remove(fd);
   }
   stop_ = true;
+  // keep the waker polled, the loop may be restarted
+  waker_.wake();
 }
 
 void EventLoop::addEvent(EventBase* event) {
-  {
-    std::lock_guard<std::mutex> guard(eventsLock_);
-    events_.push_back(event);
+  if (event->inboxQueued.exchange(true, std::memory_order_acq_rel)) {
+    return;
   }
+  events_.insertHead(event);
   waker_.wake();
 }
 
 void EventLoop::addCallback(VoidFunc&& callback) {
-  {
-    std::lock_guard<std::mutex> guard(callbacksLock_);
-    callbacks_.push_back(std::move(callback));
+  callbacks_.insertHead(std::move(callback));
+  waker_.wake();
+}
+
+void EventLoop::addCallbacks(std::vector<VoidFunc>&& callbacks) {
+  if (callbacks.empty()) {
+    return;
   }
+  callbacks_.insertHead(callbacks.begin(), callbacks.end());
   waker_.wake();
 }
 
+void EventLoop::runAfter(uint64_t delay, VoidFunc&& callback) {
+  uint64_t deadline = timestampNow() + delay;
+  if (loopThread_.load(std::memory_order_acquire) ==
+      std::this_thread::get_id()) {
+    pushTimer(deadline, std::move(callback));
+    return;
+  }
+  auto cb = makeMoveWrapper(std::move(callback));
+  addCallback([this, deadline, cb]() mutable {
+    pushTimer(deadline, cb.move());
+  });
+}
+
+void EventLoop::runWhenReady(int fd, uint32_t events, VoidFunc&& callback) {
+  ACCCHECK_GE(fd, 0);
+  if (size_t(fd) >= fdWaits_.size()) {
+    fdWaits_.resize(std::max(size_t(fd) + 1, fdWaits_.size() * 2));
+  }
+  FdWait& wait = fdWaits_[fd];
+  ACCCHECK(!wait.callback) << "fd " << fd << " already awaited";
+  wait.callback = std::move(callback);
+  if (wait.events != events) {
+    if (wait.events) {
+      poll_->modify(fd, events);
+    } else {
+      poll_->add(fd, events);
+    }
+    wait.events = events;
+  }
+}
+
+void EventLoop::cancelWhenReady(int fd) {
+  if (size_t(fd) < fdWaits_.size() && fdWaits_[fd].events) {
+    fdWaits_[fd].callback = nullptr;
+    fdWaits_[fd].events = 0;
+    poll_->remove(fd);
+  }
+}
+
+void EventLoop::releaseFiredFds() {
+  for (int fd : firedFds_) {
+    FdWait& wait = fdWaits_[fd];
+    if (!wait.callback && wait.events) {
+      wait.events = 0;
+      poll_->remove(fd);
+    }
+  }
+  firedFds_.clear();
+}
+
+void EventLoop::pushTimer(uint64_t deadline, VoidFunc&& callback) {
+  timers_.push_back(Timer{deadline, timerSeq_++, std::move(callback)});
+  std::push_heap(timers_.begin(), timers_.end());
+}
+
+void EventLoop::checkTimers() {
+  uint64_t now = timestampNow();
+  while (!timers_.empty() && timers_.front().deadline <= now) {
+    std::pop_heap(timers_.begin(), timers_.end());
+    VoidFunc callback = std::move(timers_.back().callback);
+    timers_.pop_back();
+    runHandler("timer", -1, callback);
+  }
+}
+
+int EventLoop::pollTimeout() const {
+  if (timers_.empty()) {
+    return timeout_;
+  }
+  uint64_t now = timestampNow();
+  uint64_t deadline = timers_.front().deadline;
+  // rounded up, not to wake before the deadline
+  int ms = deadline > now ? (deadline - now + 999) / 1000 : 0;
+  return timeout_ < 0 ? ms : std::min(timeout_, ms);
+}
+
 void EventLoop::dispatchEvent(EventBase* event) {
   switch (event->state()) {
     case EventBase::kListen: {
       listenFds_.push_back(event->fd());
-      poll_.add(event->fd(), EPoll::kRead);
+      // a listen fd shared by several loops wakes only one of them
+      poll_->add(event->fd(), Poller::kRead | Poller::kExclusive);
       break;
     }
     case EventBase::kNext:
     case EventBase::kToRead: {
       ACCLOG(V2) << *event << " add e/rdeadline";
-      deadlineHeap_.push(event->state() == EventBase::kNext ?
-                         event->edeadline() : event->rdeadline());
+      deadlineWheel_.push(event->state() == EventBase::kNext ?
+                          event->edeadline() : event->rdeadline());
       // already update epoll
       break;
     }
     case EventBase::kConnect:
     case EventBase::kToWrite: {
       ACCLOG(V2) << *event << " add c/wdeadline";
-      deadlineHeap_.push(event->state() == EventBase::kConnect ?
-                         event->cdeadline() : event->wdeadline());
-      poll_.add(event->fd(), EPoll::kWrite);
+      deadlineWheel_.push(event->state() == EventBase::kConnect ?
+                          event->cdeadline() : event->wdeadline());
+      poll_->add(event->fd(), Poller::kWrite);
       break;
     }
     default:
@@ -179,54 +375,65 @@ void EventLoop::dispatchEvent(EventBase* event) {
 
 void EventLoop::updateEvent(EventBase *event, uint32_t events) {
   ACCLOG(V2) << *event << " remove deadline";
-  deadlineHeap_.erase(event);
+  deadlineWheel_.erase(event);
 
   ACCLOG(V2) << *event << " update event";
-  poll_.modify(event->fd(), events);
+  poll_->modify(event->fd(), events);
 }
 
 void EventLoop::restartEvent(EventBase* event) {
   ACCLOG(V2) << *event << " remove deadline";
-  deadlineHeap_.erase(event);
+  deadlineWheel_.erase(event);
 
   event->restart();  // the next request
 
   ACCLOG(V2) << *event << " add rdeadline";
-  deadlineHeap_.push(event->rdeadline());
+  deadlineWheel_.push(event->rdeadline());
 }
 
 void EventLoop::pushEvent(EventBase* event) {
-  fdEvents_[event->fd()] = event;
+  if (event->fd() < 0) {
+    ACCLOG(ERROR) << *event << " invalid fd";
+    return;
+  }
+  size_t fd = event->fd();
+  if (fd >= fdEvents_.size()) {
+    fdEvents_.resize(std::max(fd + 1, fdEvents_.size() * 2), nullptr);
+  }
+  fdEvents_[fd] = event;
 }
 
 void EventLoop::popEvent(EventBase* event) {
   ACCLOG(V2) << *event << " remove deadline";
-  deadlineHeap_.erase(event);
+  deadlineWheel_.erase(event);
 
   ACCLOG(V2) << *event << " remove event";
-  poll_.remove(event->fd());
-  fdEvents_[event->fd()] = nullptr;
+  poll_->remove(event->fd());
+  if (size_t(event->fd()) < fdEvents_.size()) {
+    fdEvents_[event->fd()] = nullptr;
+  }
 }
 
 void EventLoop::checkTimeoutEvents() {
   uint64_t now = timestampNow();
 
   while (true) {
-    auto timeout = deadlineHeap_.pop(now);
+    auto timeout = deadlineWheel_.pop(now);
     EventBase* event = timeout.data;
     if (!event) {
       break;
     }
     if (timeout.repeat) {
       timeout.deadline += FLAGS_event_lp_timeout;
-      deadlineHeap_.push(timeout);
+      deadlineWheel_.push(timeout);
     }
     else {
       ACCLOG(V2) << *event << " pop deadline";
       event->setState(EventBase::kTimeout);
       ACCLOG(WARN) << *event << " remove timeout event: >"
         << timeout.deadline - event->starttime();
-      handler_->onTimeout(event);
+      runHandler("onTimeout", event->fd(),
+                 [&]() { handler_->onTimeout(event); });
     }
   }
 }
@@ -18,17 +18,20 @@
 
 #include <atomic>
 #include <list>
-#include <map>
-#include <mutex>
 #include <thread>
 #include <vector>
 
 #include "accelerator/Function.h"
-#include "accelerator/TimedHeap.h"
+#include "accelerator/TimingWheel.h"
 #include "accelerator/event/EPoll.h"
 #include "accelerator/event/EventBase.h"
 #include "accelerator/event/EventHandlerBase.h"
+#include "accelerator/event/Poller.h"
 #include "accelerator/io/Waker.h"
+#include "accelerator/stats/Histogram.h"
+#include "accelerator/thread/AtomicLinkedList.h"
+
+DECLARE_uint64(event_stall_budget);
 
 namespace acc {
 
@@ -36,20 +39,62 @@ class Channel;
 
 class EventLoop {
  public:
-  EventLoop(int pollSize = EPoll::kMaxEvents,
-            int pollTimeout = 1000/* 1s */);
+  EventLoop(int pollSize = Poller::kMaxEvents,
+            int pollTimeout = 1000/* 1s */,
+            Poller::Type pollerType = Poller::kEPoll);
 
-  ~EventLoop() {}
+  ~EventLoop();
 
   void registerHandler(std::unique_ptr<EventHandlerBase> handler);
 
+  Poller::Type pollerType() const {
+    return poll_->type();
+  }
+
+  enum Phase {
+    kRegisterPhase,   // adding new events
+    kCallbackPhase,
+    kTimeoutPhase,
+    kWaitPhase,       // poll wait
+    kDispatchPhase,   // handlers of ready events
+    kPhaseCount,
+  };
+
+  static const char* phaseName(Phase phase);
+
+  // Latency (us) of each phase of the loop iterations.
+  const Histogram& phaseHistogram(Phase phase) const {
+    return phases_[phase];
+  }
+
+  // Thread-safe, reports (and returns true) if the loop has not returned
+  // to poll wait within budget (us), naming the running handler.
+  bool checkStall(uint64_t budget) const;
+
   void loop();
   void loopOnce();
 
   void stop();
 
+  // Thread-safe, a no-op for an event added already and not yet taken
+  // by the loop.
   void addEvent(EventBase* event);
   void addCallback(VoidFunc&& callback);
+  // with a single wake of the loop
+  void addCallbacks(std::vector<VoidFunc>&& callbacks);
+
+  // Runs callback on the loop thread once delay (us) has passed, the
+  // poll wait is cut short for it. Thread-safe.
+  void runAfter(uint64_t delay, VoidFunc&& callback);
+
+  // Runs callback on the loop thread once fd is ready for events
+  // (Poller::kRead or kWrite), once. Loop thread only, for fds without
+  // an EventBase. The fd stays polled until the end of the dispatch, so
+  // waiting again from the callback costs no poller update.
+  void runWhenReady(int fd, uint32_t events, VoidFunc&& callback);
+  // Drops the callback of runWhenReady() on fd and stops polling it,
+  // call before closing fd from a callback.
+  void cancelWhenReady(int fd);
 
   void pushEvent(EventBase* event);
   void popEvent(EventBase* event);
@@ -63,7 +108,28 @@ class EventLoop {
 
   void checkTimeoutEvents();
 
-  EPoll poll_;
+  void pushTimer(uint64_t deadline, VoidFunc&& callback);
+  void checkTimers();
+  // poll timeout (ms) bounded by the next timer
+  int pollTimeout() const;
+
+  void dispatchReady(EventBase* event, uint32_t events);
+  // Stops polling the fired fds not waited for again.
+  void releaseFiredFds();
+
+  template <class F>
+  void runHandler(const char* name, int fd, F&& func);
+
+  void setPhase(Phase phase, uint64_t& start);
+
+  // Reports the slowest handler if busy longer than event_stall_budget.
+  void checkBusy(uint64_t now);
+
+  EventBase* fdEvent(int fd) const {
+    return size_t(fd) < fdEvents_.size() ? fdEvents_[fd] : nullptr;
+  }
+
+  std::unique_ptr<Poller> poll_;
   int timeout_;
 
   std::atomic<bool> stop_;
@@ -71,15 +137,54 @@ class EventLoop {
 
   std::vector<int> listenFds_;
   Waker waker_;
-  std::map<int, EventBase*> fdEvents_;
+  std::vector<EventBase*> fdEvents_;    // indexed by fd
+
+  // of runWhenReady(), by fd
+  struct FdWait {
+    VoidFunc callback;
+    uint32_t events{0};   // polled, 0 if not
+  };
+  std::vector<FdWait> fdWaits_;
+  std::vector<int> firedFds_;           // in this dispatch
   std::unique_ptr<EventHandlerBase> handler_;
 
-  std::vector<EventBase*> events_;
-  std::mutex eventsLock_;
-  std::vector<VoidFunc> callbacks_;
-  std::mutex callbacksLock_;
-
-  TimedHeap<EventBase> deadlineHeap_;
+  // lock-free MPSC inboxes, drained in FIFO batches once per iteration
+  AtomicIntrusiveLinkedList<EventBase, &EventBase::inboxHook> events_;
+  AtomicLinkedList<VoidFunc> callbacks_;
+
+  TimingWheel<EventBase, &EventBase::timeoutHook> deadlineWheel_;
+
+  struct Timer {
+    uint64_t deadline;
+    uint64_t seq;
+    VoidFunc callback;
+
+    // reversed for a min-heap
+    bool operator<(const Timer& other) const {
+      return deadline != other.deadline
+        ? deadline > other.deadline
+        : seq > other.seq;
+    }
+  };
+  // of runAfter(), by the loop thread only
+  std::vector<Timer> timers_;
+  uint64_t timerSeq_{0};
+
+  Histogram phases_[kPhaseCount];
+
+  // stall detection, written by the loop thread only
+  std::atomic<uint64_t> busySince_{0};    // 0 if in poll wait
+  std::atomic<int> phase_{kRegisterPhase};
+  std::atomic<const char*> handlerName_{nullptr};
+  std::atomic<int> handlerFd_{-1};
+
+  struct HandlerCost {
+    const char* name;
+    int fd;
+    uint64_t cost;
+  };
+  HandlerCost slowest_{nullptr, -1, 0};   // since last poll wait
+  uint64_t handlerStart_{0};
 };
 
 } // namespace acc
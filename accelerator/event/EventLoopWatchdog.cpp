@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/event/EventLoopWatchdog.h"
+
+#include <chrono>
+
+#include "accelerator/thread/ThreadUtil.h"
+
+namespace acc {
+
+EventLoopWatchdog::EventLoopWatchdog(uint64_t budget,
+                                     uint64_t interval,
+                                     EventLoopManager* manager)
+  : budget_(budget),
+    interval_(interval),
+    manager_(manager) {}
+
+EventLoopWatchdog::~EventLoopWatchdog() {
+  stop();
+}
+
+void EventLoopWatchdog::start() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&EventLoopWatchdog::run, this);
+}
+
+void EventLoopWatchdog::stop() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cond_.notify_all();
+  thread_.join();
+}
+
+size_t EventLoopWatchdog::check() {
+  size_t stalled = 0;
+  manager_->withEventLoopSet([&](const std::set<EventLoop*>& loops) {
+    for (auto loop : loops) {
+      if (loop->checkStall(budget_)) {
+        stalled++;
+      }
+    }
+  });
+  return stalled;
+}
+
+void EventLoopWatchdog::run() {
+  setCurrentThreadName("LoopWatchdog");
+  std::unique_lock<std::mutex> guard(lock_);
+  while (running_) {
+    cond_.wait_for(guard, std::chrono::microseconds(interval_));
+    if (running_) {
+      guard.unlock();
+      check();
+      guard.lock();
+    }
+  }
+}
+
+} // namespace acc
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "accelerator/event/EventLoopManager.h"
+
+namespace acc {
+
+/**
+ * Checks the EventLoops of an EventLoopManager every interval (us) from
+ * its own thread, and reports the loops which have not returned to poll
+ * wait within budget (us), with the handler they are running.
+ *
+ * Unlike the report of EventLoop itself, this catches loops which never
+ * return, such as a handler blocked forever.
+ */
+class EventLoopWatchdog {
+ public:
+  EventLoopWatchdog(uint64_t budget = FLAGS_event_stall_budget,
+                    uint64_t interval = 100000,
+                    EventLoopManager* manager = EventLoopManager::get());
+
+  ~EventLoopWatchdog();
+
+  EventLoopWatchdog(const EventLoopWatchdog&) = delete;
+  EventLoopWatchdog& operator=(const EventLoopWatchdog&) = delete;
+
+  void start();
+  void stop();
+
+  // Returns the number of stalled loops.
+  size_t check();
+
+ private:
+  void run();
+
+  uint64_t budget_;
+  uint64_t interval_;
+  EventLoopManager* manager_;
+  std::thread thread_;
+  std::mutex lock_;
+  std::condition_variable cond_;
+  bool running_{false};
+};
+
+} // namespace acc
@@ -25,6 +25,11 @@ namespace acc {
   x(MAX, LoopEventMax),         \
   x(AVG, LoopCost),             \
   x(MAX, LoopCostMax),          \
+  x(MAX, RegisterCostMax),      \
+  x(MAX, CallbackCostMax),      \
+  x(MAX, TimeoutCostMax),       \
+  x(MAX, WaitCostMax),          \
+  x(MAX, DispatchCostMax),      \
   x(NON, Max)
 
 ACCMON_KEY(EventMonitorKey, ACC_EVENT_MONKEY_GEN);
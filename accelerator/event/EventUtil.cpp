@@ -16,6 +16,13 @@
 
 #include "accelerator/event/EventUtil.h"
 
+#include <cstring>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include "accelerator/Exception.h"
+#include "accelerator/ScopeGuard.h"
+
 namespace acc {
 
 std::ostream& operator<<(std::ostream& os, const TimeoutOption& timeout) {
@@ -25,4 +32,40 @@ std::ostream& operator<<(std::ostream& os, const TimeoutOption& timeout) {
   return os;
 }
 
+int listenSocket(uint16_t port, bool reusePort, int backlog) {
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  checkUnixError(fd, "socket() failed");
+  SCOPE_FAIL {
+    ::close(fd);
+  };
+  int on = 1;
+  checkUnixError(
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)),
+      "setsockopt(SO_REUSEADDR) failed");
+  if (reusePort) {
+    checkUnixError(
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)),
+        "setsockopt(SO_REUSEPORT) failed");
+  }
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  checkUnixError(
+      ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)),
+      "bind(", port, ") failed");
+  checkUnixError(::listen(fd, backlog), "listen(", port, ") failed");
+  return fd;
+}
+
+uint16_t localPort(int fd) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  checkUnixError(
+      ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len),
+      "getsockname(", fd, ") failed");
+  return ntohs(addr.sin_port);
+}
+
 } // namespace acc
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <sys/socket.h>
 
 namespace acc {
 
@@ -28,4 +30,18 @@ struct TimeoutOption {
 
 std::ostream& operator<<(std::ostream& os, const TimeoutOption& timeout);
 
+/**
+ * Creates a nonblocking TCP socket listening on port of all IPv4
+ * addresses, port 0 binds an ephemeral port.
+ *
+ * With reusePort, several sockets may listen on the same port and the
+ * kernel spreads incoming connections over them, so each EventLoop can
+ * accept on its own socket.
+ */
+int listenSocket(uint16_t port, bool reusePort = false,
+                 int backlog = SOMAXCONN);
+
+// Returns the local port the socket is bound to.
+uint16_t localPort(int fd);
+
 } // namespace acc
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/event/FiberManager.h"
+
+#include "accelerator/Logging.h"
+#include "accelerator/ScopeGuard.h"
+
+namespace acc {
+
+namespace ctx = boost::context;
+
+FiberManager::FiberManager(EventLoop* loop, size_t stackSize)
+  : loop_(loop), pool_(stackSize), alive_(std::make_shared<bool>(true)) {}
+
+FiberManager::~FiberManager() {
+  alive_.reset();
+  std::unordered_set<Fiber*> fibers;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    fibers.swap(fibers_);
+  }
+  for (Fiber* fiber : fibers) {
+    // unwinds the suspended fiber on its stack, or drops it if not started
+    delete fiber;
+  }
+}
+
+void FiberManager::addTask(VoidFunc&& func) {
+  Fiber* fiber = new Fiber;
+  fiber->func = std::move(func);
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    fibers_.insert(fiber);
+  }
+  std::weak_ptr<bool> alive = alive_;
+  loop_->addCallback([this, fiber, alive]() {
+    if (alive.lock()) {
+      start(fiber);
+    }
+  });
+}
+
+void FiberManager::start(Fiber* fiber) {
+  ACCLOG(V5) << "fiber " << fiber << " start";
+  current_ = fiber;
+  fiber->self = ctx::callcc(
+      std::allocator_arg,
+      PooledStackAllocator(&pool_),
+      [fiber](ctx::continuation&& caller) {
+    fiber->caller = std::move(caller);
+    try {
+      fiber->func();
+    } catch (const std::exception& e) {
+      ACCLOG(ERROR) << "fiber " << fiber << " throws: " << e.what();
+    }
+    return std::move(fiber->caller);
+  });
+  current_ = nullptr;
+  finish(fiber);
+}
+
+void FiberManager::resume(Fiber* fiber) {
+  ACCLOG(V5) << "fiber " << fiber << " resume";
+  current_ = fiber;
+  fiber->self = std::move(fiber->self).resume();
+  current_ = nullptr;
+  finish(fiber);
+}
+
+void FiberManager::suspend() {
+  Fiber* fiber = running();
+  ACCLOG(V5) << "fiber " << fiber << " suspend";
+  fiber->caller = std::move(fiber->caller).resume();
+}
+
+void FiberManager::finish(Fiber* fiber) {
+  if (!fiber->self) {
+    ACCLOG(V5) << "fiber " << fiber << " finish";
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      fibers_.erase(fiber);
+    }
+    delete fiber;
+  }
+}
+
+void FiberManager::wake(Fiber* fiber, Wait* wait, bool ready) {
+  if (wait->done) {
+    return;
+  }
+  wait->done = true;
+  wait->ready = ready;
+  resume(fiber);
+}
+
+FiberManager::Fiber* FiberManager::running() const {
+  ACCCHECK(current_) << "not on a fiber";
+  return current_;
+}
+
+bool FiberManager::awaitReady(int fd, uint32_t events, uint64_t timeout) {
+  Fiber* fiber = running();
+  auto wait = std::make_shared<Wait>();
+  loop_->runWhenReady(fd, events, [this, fiber, wait]() {
+    wake(fiber, wait.get(), true);
+  });
+  if (timeout > 0) {
+    loop_->runAfter(timeout, [this, fiber, wait, fd]() {
+      if (!wait->done) {
+        loop_->cancelWhenReady(fd);
+        wake(fiber, wait.get(), false);
+      }
+    });
+  }
+  SCOPE_EXIT {
+    // unwound while waiting
+    if (!wait->done) {
+      wait->done = true;
+      loop_->cancelWhenReady(fd);
+    }
+  };
+  suspend();
+  return wait->ready;
+}
+
+void FiberManager::sleep(uint64_t delay) {
+  Fiber* fiber = running();
+  auto wait = std::make_shared<Wait>();
+  loop_->runAfter(delay, [this, fiber, wait]() {
+    wake(fiber, wait.get(), true);
+  });
+  SCOPE_EXIT { wait->done = true; };
+  suspend();
+}
+
+void FiberManager::yield() {
+  Fiber* fiber = running();
+  auto wait = std::make_shared<Wait>();
+  loop_->addCallback([this, fiber, wait]() {
+    wake(fiber, wait.get(), true);
+  });
+  SCOPE_EXIT { wait->done = true; };
+  suspend();
+}
+
+} // namespace acc
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include <boost/context/continuation.hpp>
+
+#include "accelerator/Function.h"
+#include "accelerator/event/EventLoop.h"
+#include "accelerator/event/FiberStackPool.h"
+
+namespace acc {
+
+/**
+ * Stackful fibers run on the thread of an EventLoop.
+ *
+ * A fiber is started by addTask(), and runs until it waits, on fd
+ * readiness by awaitReady(), on a timer by sleep(), or yields to the loop
+ * by yield(). The loop resumes it once the wait is over, so handler code
+ * reads as plain sequential calls instead of a state machine over the
+ * EventBase states.
+ *
+ * Fibers are switched by boost::context, on stacks of a FiberStackPool.
+ * All but addTask() are called on the loop thread, the wait functions
+ * from within a fiber. Suspended fibers are unwound on destruction, which
+ * happens on the loop thread or once the loop has stopped, and the fibers
+ * not started yet are dropped.
+ *
+ * Usage:
+ *
+ *   FiberManager fm(loop);
+ *   fm.addTask([&]() {
+ *     while (fm.awaitReady(fd, Poller::kRead, 1000000)) {
+ *       ssize_t n = ::read(fd, buf, sizeof(buf));
+ *       ...
+ *     }
+ *   });
+ */
+class FiberManager {
+ public:
+  explicit FiberManager(EventLoop* loop, size_t stackSize = 64 * 1024);
+  ~FiberManager();
+
+  FiberManager(const FiberManager&) = delete;
+  FiberManager& operator=(const FiberManager&) = delete;
+
+  EventLoop* loop() const {
+    return loop_;
+  }
+
+  // Starts func on a new fiber from the loop. Thread-safe.
+  void addTask(VoidFunc&& func);
+
+  // Suspends the fiber until fd is ready for events (Poller::kRead or
+  // kWrite), returns false if timeout (us, 0 for none) passes first.
+  bool awaitReady(int fd, uint32_t events, uint64_t timeout = 0);
+
+  // Suspends the fiber for delay (us).
+  void sleep(uint64_t delay);
+
+  // Suspends the fiber until the next iteration of the loop.
+  void yield();
+
+  // true if called from a fiber of this manager
+  bool onFiber() const {
+    return current_ != nullptr;
+  }
+
+  // fibers added and not finished
+  size_t fiberCount() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    return fibers_.size();
+  }
+
+  const FiberStackPool& stackPool() const {
+    return pool_;
+  }
+
+ private:
+  struct Fiber {
+    VoidFunc func;
+    boost::context::continuation self;    // of the fiber, while suspended
+    boost::context::continuation caller;  // of the loop, while running
+  };
+
+  // shared by the callbacks which may end a wait
+  struct Wait {
+    bool done{false};
+    bool ready{false};
+  };
+
+  void start(Fiber* fiber);
+  void resume(Fiber* fiber);
+  void suspend();
+  void wake(Fiber* fiber, Wait* wait, bool ready);
+  void finish(Fiber* fiber);
+
+  Fiber* running() const;
+
+  EventLoop* loop_;
+  FiberStackPool pool_;   // outlives the fibers unwound on destruction
+  mutable std::mutex lock_;
+  std::unordered_set<Fiber*> fibers_;
+  // expires on destruction, checked by the start callbacks left behind
+  std::shared_ptr<bool> alive_;
+  Fiber* current_{nullptr};
+};
+
+} // namespace acc
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/event/FiberStackPool.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "accelerator/Exception.h"
+#include "accelerator/MemoryProtect.h"
+
+namespace acc {
+
+FiberStackPool::FiberStackPool(size_t stackSize, size_t maxPooled)
+  : pageSize_(sysconf(_SC_PAGESIZE)),
+    maxPooled_(maxPooled) {
+  // whole pages
+  stackSize_ = (stackSize + pageSize_ - 1) / pageSize_ * pageSize_;
+}
+
+FiberStackPool::~FiberStackPool() {
+  for (void* p : free_) {
+    munmap(p, stackSize_ + pageSize_);
+  }
+}
+
+boost::context::stack_context FiberStackPool::allocate() {
+  void* p;
+  if (!free_.empty()) {
+    p = free_.back();
+    free_.pop_back();
+  } else {
+    p = mmap(nullptr, stackSize_ + pageSize_, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      throwSystemError("mmap fiber stack failed");
+    }
+    MemoryProtect(p, pageSize_).ban();
+    allocated_++;
+  }
+  boost::context::stack_context sctx;
+  // stacks grow down from the top
+  sctx.size = stackSize_;
+  sctx.sp = static_cast<char*>(p) + pageSize_ + stackSize_;
+  return sctx;
+}
+
+void FiberStackPool::deallocate(boost::context::stack_context& sctx) {
+  void* p = static_cast<char*>(sctx.sp) - stackSize_ - pageSize_;
+  if (free_.size() < maxPooled_) {
+    free_.push_back(p);
+  } else {
+    munmap(p, stackSize_ + pageSize_);
+    allocated_--;
+  }
+}
+
+} // namespace acc
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/context/stack_context.hpp>
+
+namespace acc {
+
+/**
+ * Pool of fiber stacks, for a single thread.
+ *
+ * Each stack is mmap-ed with a guard page below it, banned by
+ * MemoryProtect, so an overflow faults instead of corrupting the memory
+ * next to it. Released stacks are kept for reuse, up to maxPooled, so
+ * starting a fiber costs neither a mmap nor a mprotect.
+ */
+class FiberStackPool {
+ public:
+  explicit FiberStackPool(size_t stackSize = 64 * 1024,
+                          size_t maxPooled = 1024);
+  ~FiberStackPool();
+
+  FiberStackPool(const FiberStackPool&) = delete;
+  FiberStackPool& operator=(const FiberStackPool&) = delete;
+
+  boost::context::stack_context allocate();
+  void deallocate(boost::context::stack_context& sctx);
+
+  size_t stackSize() const {
+    return stackSize_;
+  }
+
+  // stacks mapped, and kept for reuse
+  size_t allocated() const {
+    return allocated_;
+  }
+  size_t pooled() const {
+    return free_.size();
+  }
+
+ private:
+  size_t stackSize_;
+  size_t pageSize_;
+  size_t maxPooled_;
+  size_t allocated_{0};
+  // bottom of the mapping (the guard page) of free stacks
+  std::vector<void*> free_;
+};
+
+// StackAllocator of boost::context on a FiberStackPool.
+class PooledStackAllocator {
+ public:
+  explicit PooledStackAllocator(FiberStackPool* pool) : pool_(pool) {}
+
+  boost::context::stack_context allocate() {
+    return pool_->allocate();
+  }
+
+  void deallocate(boost::context::stack_context& sctx) {
+    pool_->deallocate(sctx);
+  }
+
+ private:
+  FiberStackPool* pool_;
+};
+
+} // namespace acc
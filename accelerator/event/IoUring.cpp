@@ -0,0 +1,261 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/event/IoUring.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "accelerator/Exception.h"
+#include "accelerator/Logging.h"
+#include "accelerator/ScopeGuard.h"
+
+namespace acc {
+
+namespace {
+
+// user_data of internal requests whose completions are ignored
+constexpr uint64_t kInternal = ~uint64_t(0);
+
+inline uint64_t userData(int fd, uint32_t gen) {
+  return uint64_t(gen) << 32 | uint32_t(fd);
+}
+
+template <class T>
+inline T* ringPtr(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+} // namespace
+
+IoUring::IoUring(int size)
+  : size_(size),
+    ring_(MAP_FAILED),
+    sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+    events_(size) {
+  io_uring_params p;
+  ::memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CLAMP;
+  fd_ = ::syscall(__NR_io_uring_setup, size, &p);
+  if (fd_ == -1) {
+    throwSystemError("io_uring_setup(", size, ") failed");
+  }
+  SCOPE_FAIL {
+    if (ring_ != MAP_FAILED) {
+      ::munmap(ring_, ringSize_);
+    }
+    ::close(fd_);
+  };
+  if (!(p.features & IORING_FEAT_SINGLE_MMAP) ||
+      !(p.features & IORING_FEAT_EXT_ARG)) {
+    throw std::runtime_error("io_uring: kernel too old");
+  }
+
+  ringSize_ = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                       p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+  ring_ = ::mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    throwSystemError("io_uring mmap ring failed");
+  }
+  sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    throwSystemError("io_uring mmap sqes failed");
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sqHead_ = ringPtr<unsigned>(ring_, p.sq_off.head);
+  sqTail_ = ringPtr<unsigned>(ring_, p.sq_off.tail);
+  sqMask_ = *ringPtr<unsigned>(ring_, p.sq_off.ring_mask);
+  sqEntries_ = p.sq_entries;
+  sqArray_ = ringPtr<unsigned>(ring_, p.sq_off.array);
+  cqHead_ = ringPtr<unsigned>(ring_, p.cq_off.head);
+  cqTail_ = ringPtr<unsigned>(ring_, p.cq_off.tail);
+  cqMask_ = *ringPtr<unsigned>(ring_, p.cq_off.ring_mask);
+  cqes_ = ringPtr<io_uring_cqe>(ring_, p.cq_off.cqes);
+
+  // sqes are always used in ring order
+  for (unsigned i = 0; i < sqEntries_; i++) {
+    sqArray_[i] = i;
+  }
+}
+
+IoUring::~IoUring() {
+  ::munmap(sqes_, sqesSize_);
+  ::munmap(ring_, ringSize_);
+  ::close(fd_);
+}
+
+void IoUring::add(int fd, uint32_t events) {
+  if (fd < 0) {
+    ACCLOG(ERROR) << "io_uring add(" << fd << ") failed: invalid fd";
+    return;
+  }
+  std::lock_guard<std::mutex> guard(lock_);
+  if (size_t(fd) >= fds_.size()) {
+    fds_.resize(std::max(size_t(fd) + 1, fds_.size() * 2));
+  }
+  Registration& r = fds_[fd];
+  if (r.active) {
+    // the fd was closed and reused without remove
+    disarm(fd);
+  }
+  r.events = events;
+  r.gen++;
+  r.active = true;
+  arm(fd);
+}
+
+void IoUring::modify(int fd, uint32_t events) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (fd < 0 || size_t(fd) >= fds_.size() || !fds_[fd].active) {
+    ACCLOG(ERROR) << "io_uring modify(" << fd << ") failed: not added";
+    return;
+  }
+  Registration& r = fds_[fd];
+  disarm(fd);
+  r.events = events;
+  r.gen++;
+  arm(fd);
+}
+
+void IoUring::remove(int fd) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (fd < 0 || size_t(fd) >= fds_.size() || !fds_[fd].active) {
+    return;
+  }
+  Registration& r = fds_[fd];
+  disarm(fd);
+  r.active = false;
+  r.gen++;
+}
+
+int IoUring::wait(int timeout) {
+  __kernel_timespec ts;
+  ts.tv_sec = timeout / 1000;
+  ts.tv_nsec = (timeout % 1000) * 1000000L;
+  io_uring_getevents_arg arg;
+  ::memset(&arg, 0, sizeof(arg));
+  arg.sigmask_sz = _NSIG / 8;
+  arg.ts = timeout >= 0 ? reinterpret_cast<uint64_t>(&ts) : 0;
+
+  unsigned toSubmit;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    toSubmit = pendingSqes();
+  }
+  bool ready = *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  int r = enter(toSubmit, ready ? 0 : 1,
+                IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                &arg, sizeof(arg));
+  if (r == -1 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+    ACCPLOG(ERROR) << "io_uring_enter failed";
+    return -1;
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  batch_++;
+  int n = 0;
+  unsigned head = *cqHead_;
+  unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    const io_uring_cqe& cqe = cqes_[head & cqMask_];
+    if (cqe.user_data == kInternal) {
+      continue;
+    }
+    int fd = int(uint32_t(cqe.user_data));
+    uint32_t gen = cqe.user_data >> 32;
+    if (size_t(fd) >= fds_.size() ||
+        !fds_[fd].active || fds_[fd].gen != gen) {
+      continue;   // completion of a removed request
+    }
+    Registration& reg = fds_[fd];
+    if (reg.batch != batch_) {
+      if (n == size_) {
+        break;    // left for the next wait
+      }
+      reg.batch = batch_;
+      reg.index = n++;
+      events_[reg.index].data.fd = fd;
+      events_[reg.index].events = 0;
+    }
+    if (cqe.res < 0) {
+      ACCLOG(ERROR) << "io_uring poll(" << fd << ") failed: "
+                    << strerror(-cqe.res);
+      events_[reg.index].events |= EPOLLERR;
+    } else {
+      events_[reg.index].events |= cqe.res;
+      arm(fd);
+    }
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+  return n;
+}
+
+bool IoUring::push(const io_uring_sqe& sqe) {
+  unsigned tail = *sqTail_;
+  if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+    enter(pendingSqes(), 0, 0, nullptr, 0);
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      ACCLOG(ERROR) << "io_uring submission queue full";
+      return false;
+    }
+  }
+  sqes_[tail & sqMask_] = sqe;
+  __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void IoUring::arm(int fd) {
+  const Registration& r = fds_[fd];
+  io_uring_sqe sqe;
+  ::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_POLL_ADD;
+  sqe.fd = fd;
+  sqe.poll32_events = r.events;
+  sqe.user_data = userData(fd, r.gen);
+  push(sqe);
+}
+
+void IoUring::disarm(int fd) {
+  const Registration& r = fds_[fd];
+  io_uring_sqe sqe;
+  ::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_POLL_REMOVE;
+  sqe.fd = -1;
+  sqe.addr = userData(fd, r.gen);
+  sqe.user_data = kInternal;
+  push(sqe);
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete, unsigned flags,
+                   const void* arg, size_t argSize) {
+  return ::syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, flags,
+                   arg, argSize);
+}
+
+unsigned IoUring::pendingSqes() const {
+  return *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+} // namespace acc
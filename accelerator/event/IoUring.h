@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <linux/io_uring.h>
+
+#include "accelerator/event/Poller.h"
+
+namespace acc {
+
+/**
+ * io_uring backend of Poller, using raw syscalls.
+ *
+ * Each fd is watched by one oneshot poll request, re-armed after every
+ * completion, which keeps the level-triggered semantics of EPoll (kernel
+ * multishot poll is edge-triggered). add/modify/remove and re-arms only
+ * queue SQEs, which are submitted in one io_uring_enter together with
+ * waiting for completions.
+ *
+ * Completions of one wait for the same fd are merged into one event.
+ * Requests queued from other threads are submitted by the next wait.
+ * The constructor throws if the kernel lacks single mmap or ext arg.
+ */
+class IoUring : public Poller {
+ public:
+  explicit IoUring(int size = kMaxEvents);
+
+  ~IoUring() override;
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  Type type() const override {
+    return kIoUring;
+  }
+
+  void add(int fd, uint32_t events) override;
+  void modify(int fd, uint32_t events) override;
+  void remove(int fd) override;
+
+  int wait(int timeout) override;
+
+  struct epoll_event get(int i) const override {
+    return events_[i];
+  }
+
+ private:
+  struct Registration {
+    uint32_t events{0};
+    uint32_t gen{0};        // tags the current poll request of fd
+    bool active{false};
+    uint64_t batch{0};      // last wait delivering the fd
+    int index{0};           // its index in events_ of that wait
+  };
+
+  bool push(const io_uring_sqe& sqe);
+  void arm(int fd);
+  void disarm(int fd);
+  int enter(unsigned toSubmit, unsigned minComplete, unsigned flags,
+            const void* arg, size_t argSize);
+  unsigned pendingSqes() const;
+
+  int fd_;
+  int size_;
+
+  void* ring_;
+  size_t ringSize_;
+  io_uring_sqe* sqes_;
+  size_t sqesSize_;
+
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned* sqArray_;
+
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+
+  std::vector<Registration> fds_;     // indexed by fd
+  std::vector<epoll_event> events_;
+  uint64_t batch_{0};
+  std::mutex lock_;                   // SQ and fds_
+};
+
+} // namespace acc
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/event/Poller.h"
+
+#include <exception>
+
+#include "accelerator/Logging.h"
+#include "accelerator/event/EPoll.h"
+#include "accelerator/event/IoUring.h"
+
+namespace acc {
+
+std::unique_ptr<Poller> Poller::create(Type type, int size) {
+  if (type == kIoUring) {
+    try {
+      return std::unique_ptr<Poller>(new IoUring(size));
+    } catch (std::exception& e) {
+      ACCLOG(WARN) << "io_uring unavailable, fall back to epoll: " << e.what();
+    }
+  }
+  return std::unique_ptr<Poller>(new EPoll(size));
+}
+
+const char* pollerTypeName(Poller::Type type) {
+  switch (type) {
+    case Poller::kEPoll: return "epoll";
+    case Poller::kIoUring: return "io_uring";
+  }
+  return "unknown";
+}
+
+} // namespace acc
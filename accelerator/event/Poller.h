@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <sys/epoll.h>
+
+namespace acc {
+
+/**
+ * Readiness poller interface of EventLoop.
+ *
+ * All backends report level-triggered readiness as epoll_event, keyed
+ * by fd, so EventLoop dispatches the same way whichever is used.
+ */
+class Poller {
+ public:
+  enum Type {
+    kEPoll,
+    kIoUring,
+  };
+
+  enum : uint32_t {
+    kRead = EPOLLIN,
+    kWrite = EPOLLOUT,
+    kError = EPOLLERR | EPOLLHUP,
+    // wake only one of the pollers sharing the fd, add only
+    kExclusive = EPOLLEXCLUSIVE,
+  };
+
+  static constexpr int kMaxEvents = 1024;
+
+  // Falls back to EPoll if the backend is not supported by the kernel.
+  static std::unique_ptr<Poller> create(Type type, int size = kMaxEvents);
+
+  virtual ~Poller() {}
+
+  virtual Type type() const = 0;
+
+  virtual void add(int fd, uint32_t events) = 0;
+  virtual void modify(int fd, uint32_t events) = 0;
+  virtual void remove(int fd) = 0;
+
+  virtual int wait(int timeout) = 0;
+
+  virtual struct epoll_event get(int i) const = 0;
+};
+
+const char* pollerTypeName(Poller::Type type);
+
+} // namespace acc
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "accelerator/event/EventLoop.h"
+#include "accelerator/event/EventLoopWatchdog.h"
+
+using namespace acc;
+
+class NullEvent : public EventBase {
+ public:
+  NullEvent() : EventBase({60000000, 60000000, 60000000}) {}
+
+  int fd() const override {
+    return -1;
+  }
+
+  std::string str() const override {
+    return "null";
+  }
+};
+
+TEST(EventLoop, addEventTwice) {
+  NullEvent event;
+  {
+    EventLoop loop(Poller::kMaxEvents, 1);
+    loop.addEvent(&event);
+    // still queued, a no-op
+    loop.addEvent(&event);
+    EXPECT_TRUE(event.inboxQueued);
+  }
+  EXPECT_FALSE(event.inboxQueued);
+  EXPECT_EQ(nullptr, event.inboxHook.next);
+}
+
+TEST(EventLoop, phaseHistograms) {
+  EventLoop loop(Poller::kMaxEvents, 1);
+  for (int i = 0; i < 10; i++) {
+    loop.loopOnce();
+  }
+  for (int i = 0; i < EventLoop::kPhaseCount; i++) {
+    auto phase = EventLoop::Phase(i);
+    EXPECT_EQ(10, loop.phaseHistogram(phase).count())
+      << EventLoop::phaseName(phase);
+  }
+  EXPECT_LE(1000, loop.phaseHistogram(EventLoop::kWaitPhase).percentile(50));
+}
+
+TEST(EventLoop, stall) {
+  EventLoop loop(Poller::kMaxEvents, 10);
+  std::thread t([&]() {
+    EventLoopManager::get()->setEventLoop(&loop, false);
+    loop.loop();
+    EventLoopManager::get()->clearEventLoop();
+  });
+
+  std::atomic<bool> running(false);
+  std::atomic<bool> release(false);
+  loop.addCallback([&]() {
+    running = true;
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  while (!running) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(loop.checkStall(10000));
+  EXPECT_FALSE(loop.checkStall(10000000));
+
+  EventLoopWatchdog watchdog(10000);
+  EXPECT_EQ(1, watchdog.check());
+
+  release = true;
+  loop.stop();
+  t.join();
+  EXPECT_FALSE(loop.checkStall(0));
+  EXPECT_EQ(0, watchdog.check());
+}
+
+TEST(EventLoop, runAfter) {
+  EventLoop loop(Poller::kMaxEvents, 1000);
+  std::thread t([&]() { loop.loop(); });
+
+  std::vector<int> order;
+  std::atomic<int> done(0);
+  uint64_t start = timestampNow();
+  uint64_t fired = 0;
+  loop.runAfter(20000, [&]() {
+    order.push_back(2);
+    fired = timePassed(start);
+    done++;
+  });
+  loop.runAfter(10000, [&]() {
+    order.push_back(1);
+    // from the loop thread
+    loop.runAfter(0, [&]() { order.push_back(0); done++; });
+    done++;
+  });
+  while (done < 3) {
+    std::this_thread::yield();
+  }
+  std::vector<int> expected = {1, 0, 2};
+  EXPECT_EQ(expected, order);
+  // not held back by the 1s poll timeout
+  EXPECT_LE(20000, fired);
+  EXPECT_GT(500000, fired);
+
+  loop.stop();
+  t.join();
+}
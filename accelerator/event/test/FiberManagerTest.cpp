@@ -0,0 +1,163 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "accelerator/ScopeGuard.h"
+#include "accelerator/Time.h"
+#include "accelerator/event/FiberManager.h"
+
+using namespace acc;
+
+TEST(FiberStackPool, reuse) {
+  FiberStackPool pool(10000, 1);
+  EXPECT_EQ(0, pool.stackSize() % sysconf(_SC_PAGESIZE));
+  EXPECT_LE(10000, pool.stackSize());
+
+  auto a = pool.allocate();
+  auto b = pool.allocate();
+  EXPECT_EQ(2, pool.allocated());
+  pool.deallocate(a);
+  pool.deallocate(b);
+  // only one kept
+  EXPECT_EQ(1, pool.allocated());
+  EXPECT_EQ(1, pool.pooled());
+
+  auto c = pool.allocate();
+  EXPECT_EQ(a.sp, c.sp);
+  EXPECT_EQ(0, pool.pooled());
+  pool.deallocate(c);
+}
+
+TEST(FiberManager, yield) {
+  EventLoop loop(Poller::kMaxEvents, 1);
+  FiberManager fm(&loop);
+  std::vector<std::string> order;
+  fm.addTask([&]() {
+    EXPECT_TRUE(fm.onFiber());
+    order.push_back("a1");
+    fm.yield();
+    order.push_back("a2");
+  });
+  fm.addTask([&]() {
+    order.push_back("b1");
+    fm.yield();
+    order.push_back("b2");
+  });
+  EXPECT_FALSE(fm.onFiber());
+  loop.loopOnce();
+  EXPECT_EQ(2, fm.fiberCount());
+  loop.loopOnce();
+  EXPECT_EQ(0, fm.fiberCount());
+  std::vector<std::string> expected = {"a1", "b1", "a2", "b2"};
+  EXPECT_EQ(expected, order);
+  // stacks back to the pool
+  EXPECT_EQ(2, fm.stackPool().pooled());
+}
+
+TEST(FiberManager, sleep) {
+  EventLoop loop(Poller::kMaxEvents, 1000);
+  FiberManager fm(&loop);
+  uint64_t slept = 0;
+  fm.addTask([&]() {
+    uint64_t start = timestampNow();
+    fm.sleep(10000);
+    slept = timePassed(start);
+    loop.stop();
+  });
+  loop.loop();
+  EXPECT_LE(10000, slept);
+  EXPECT_GT(500000, slept);
+}
+
+TEST(FiberManager, awaitReady) {
+  EventLoop loop(Poller::kMaxEvents, 10);
+  FiberManager fm(&loop);
+  int fds[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+  std::string received;
+  bool timedOut = false;
+  fm.addTask([&]() {
+    char buf[16];
+    while (fm.awaitReady(fds[1], Poller::kRead, 50000)) {
+      ssize_t n = ::read(fds[1], buf, sizeof(buf));
+      if (n <= 0) {
+        break;
+      }
+      received.append(buf, n);
+    }
+    timedOut = true;
+    loop.stop();
+  });
+  std::thread t([&]() { loop.loop(); });
+  ASSERT_EQ(5, ::write(fds[0], "hello", 5));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(6, ::write(fds[0], " fiber", 6));
+  t.join();
+
+  EXPECT_EQ("hello fiber", received);
+  EXPECT_TRUE(timedOut);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+TEST(FiberManager, unwind) {
+  EventLoop loop(Poller::kMaxEvents, 1);
+  int fds[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  bool unwound = false;
+  {
+    FiberManager fm(&loop);
+    fm.addTask([&]() {
+      SCOPE_EXIT { unwound = true; };
+      fm.awaitReady(fds[1], Poller::kRead);
+    });
+    loop.loopOnce();
+    EXPECT_EQ(1, fm.fiberCount());
+  }
+  EXPECT_TRUE(unwound);
+  // the fd is free to await again
+  ASSERT_EQ(1, ::write(fds[0], "x", 1));
+  bool ready = false;
+  loop.runWhenReady(fds[1], Poller::kRead, [&]() { ready = true; });
+  loop.loopOnce();
+  EXPECT_TRUE(ready);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+TEST(FiberManager, destroyBeforeStart) {
+  EventLoop loop(Poller::kMaxEvents, 1);
+  auto flag = std::make_shared<int>(0);
+  {
+    FiberManager fm(&loop);
+    fm.addTask([flag]() { (*flag)++; });
+    EXPECT_EQ(1, fm.fiberCount());
+    EXPECT_EQ(2, flag.use_count());
+  }
+  // dropped by the manager, and not started by the loop
+  EXPECT_EQ(1, flag.use_count());
+  loop.loopOnce();
+  EXPECT_EQ(0, *flag);
+}
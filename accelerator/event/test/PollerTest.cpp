@@ -0,0 +1,101 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "accelerator/event/Poller.h"
+
+using namespace acc;
+
+static uint32_t eventsOf(Poller& poller, int n, int fd) {
+  uint32_t events = 0;
+  for (int i = 0; i < n; i++) {
+    if (poller.get(i).data.fd == fd) {
+      events |= poller.get(i).events;
+    }
+  }
+  return events;
+}
+
+static void readWriteReadiness(Poller::Type type) {
+  auto poller = Poller::create(type, 16);
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+
+  poller->add(fds[0], Poller::kRead);
+  EXPECT_EQ(0, poller->wait(0));
+
+  ASSERT_EQ(1, ::write(fds[1], "x", 1));
+  int n = poller->wait(1000);
+  EXPECT_EQ(1, n);
+  EXPECT_TRUE(eventsOf(*poller, n, fds[0]) & Poller::kRead);
+
+  // level-triggered: still readable until drained
+  n = poller->wait(1000);
+  EXPECT_EQ(1, n);
+  EXPECT_TRUE(eventsOf(*poller, n, fds[0]) & Poller::kRead);
+
+  char c;
+  ASSERT_EQ(1, ::read(fds[0], &c, 1));
+  EXPECT_EQ(0, poller->wait(10));
+
+  poller->add(fds[1], Poller::kRead);
+  poller->modify(fds[1], Poller::kWrite);
+  n = poller->wait(1000);
+  EXPECT_EQ(1, n);
+  EXPECT_TRUE(eventsOf(*poller, n, fds[1]) & Poller::kWrite);
+
+  poller->remove(fds[1]);
+  ASSERT_EQ(1, ::write(fds[1], "x", 1));
+  poller->remove(fds[0]);
+  EXPECT_EQ(0, poller->wait(10));
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+static void exclusiveReadiness(Poller::Type type) {
+  auto poller1 = Poller::create(type, 16);
+  auto poller2 = Poller::create(type, 16);
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+
+  poller1->add(fds[0], Poller::kRead | Poller::kExclusive);
+  poller2->add(fds[0], Poller::kRead | Poller::kExclusive);
+  ASSERT_EQ(1, ::write(fds[1], "x", 1));
+  EXPECT_TRUE(eventsOf(*poller1, poller1->wait(1000), fds[0]) & Poller::kRead);
+  EXPECT_TRUE(eventsOf(*poller2, poller2->wait(1000), fds[0]) & Poller::kRead);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+TEST(Poller, epoll) {
+  readWriteReadiness(Poller::kEPoll);
+}
+
+TEST(Poller, io_uring) {
+  readWriteReadiness(Poller::kIoUring);
+}
+
+TEST(Poller, epollExclusive) {
+  exclusiveReadiness(Poller::kEPoll);
+}
+
+TEST(Poller, io_uringExclusive) {
+  exclusiveReadiness(Poller::kIoUring);
+}
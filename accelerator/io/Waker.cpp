@@ -18,32 +18,60 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "accelerator/Logging.h"
 #include "accelerator/io/FileUtil.h"
 
 namespace acc {
 
-Waker::Waker() {
-  if (::pipe2(pipeFds_, O_CLOEXEC | O_NONBLOCK) == -1) {
+Waker::Waker(bool useEventFd) {
+  if (useEventFd) {
+    int fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd != -1) {
+      fds_[0] = fds_[1] = fd;
+      return;
+    }
+    ACCPLOG(WARN) << "eventfd failed, fallback to pipe";
+  }
+  if (::pipe2(fds_, O_CLOEXEC | O_NONBLOCK) == -1) {
     ACCPLOG(ERROR) << "pipe2 failed";
   }
 }
 
 void Waker::wake() const {
-  writeNoInt(pipeFds_[1], (void*)"x", 1);
+  if (signaled_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  if (isEventFd()) {
+    uint64_t n = 1;
+    writeNoInt(fds_[1], &n, sizeof(n));
+  } else {
+    writeNoInt(fds_[1], (void*)"x", 1);
+  }
   ACCLOG(V2) << *this << " wake";
 }
 
 void Waker::consume() const {
-  char c;
-  while (readNoInt(pipeFds_[0], &c, 1) > 0) {}
+  if (isEventFd()) {
+    uint64_t n;
+    readNoInt(fds_[0], &n, sizeof(n));
+  } else {
+    char buf[64];
+    while (readNoInt(fds_[0], buf, sizeof(buf)) > 0) {}
+  }
+  // clear after draining, a wake() racing with the drain at worst leaves
+  // a spurious wakeup for the next poll; acquire pairs with wake() so that
+  // the work posted by coalesced producers is visible to the loop
+  signaled_.exchange(false, std::memory_order_acq_rel);
   ACCLOG(V2) << *this << " consume";
 }
 
 void Waker::close() {
-  ::close(pipeFds_[0]);
-  ::close(pipeFds_[1]);
+  ::close(fds_[0]);
+  if (!isEventFd()) {
+    ::close(fds_[1]);
+  }
 }
 
 std::ostream& operator<<(std::ostream& os, const Waker& waker) {
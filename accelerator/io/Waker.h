@@ -16,24 +16,39 @@
 
 #pragma once
 
+#include <atomic>
 #include <iostream>
 
 namespace acc {
 
+/**
+ * Wakes up a poll loop from other threads.
+ *
+ * Based on eventfd by default, falls back to pipe if eventfd is unavailable
+ * or not wanted.  Wakeups are coalesced: after the first wake() no more
+ * syscall is issued until the loop calls consume(), so N producers cost at
+ * most one write per loop iteration.
+ *
+ * consume() must be called before the loop checks its pending work.
+ */
 class Waker {
  public:
-  Waker();
+  explicit Waker(bool useEventFd = true);
 
   ~Waker() {
     close();
   }
 
   int fd() const {
-    return pipeFds_[0];
+    return fds_[0];
   }
 
   int fd2() const {
-    return pipeFds_[1];
+    return fds_[1];
+  }
+
+  bool isEventFd() const {
+    return fds_[0] == fds_[1];
   }
 
   void wake() const;
@@ -43,7 +58,8 @@ class Waker {
  private:
   void close();
 
-  int pipeFds_[2];
+  int fds_[2];
+  mutable std::atomic<bool> signaled_{false};
 };
 
 std::ostream& operator<<(std::ostream& os, const Waker& waker);
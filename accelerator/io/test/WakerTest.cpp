@@ -0,0 +1,55 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <gtest/gtest.h>
+
+#include "accelerator/io/Waker.h"
+
+using namespace acc;
+
+static bool readable(const Waker& waker) {
+  struct pollfd pfd = { waker.fd(), POLLIN, 0 };
+  return ::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+static void wakeAndConsume(bool useEventFd) {
+  Waker waker(useEventFd);
+  EXPECT_EQ(useEventFd, waker.isEventFd());
+  EXPECT_FALSE(readable(waker));
+
+  waker.wake();
+  waker.wake();
+  waker.wake();
+  EXPECT_TRUE(readable(waker));
+
+  waker.consume();
+  EXPECT_FALSE(readable(waker));
+
+  // wake again after consume
+  waker.wake();
+  EXPECT_TRUE(readable(waker));
+  waker.consume();
+  EXPECT_FALSE(readable(waker));
+}
+
+TEST(Waker, eventfd) {
+  wakeAndConsume(true);
+}
+
+TEST(Waker, pipe) {
+  wakeAndConsume(false);
+}
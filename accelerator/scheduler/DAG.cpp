@@ -16,11 +16,24 @@
 
 #include "accelerator/scheduler/DAG.h"
 
+#include <algorithm>
+#include <typeinfo>
+
+#include "accelerator/Logging.h"
+#include "accelerator/Time.h"
+#include "accelerator/thread/ThreadUtil.h"
+
 namespace acc {
 
 DAG::Key DAG::add(VoidFunc&& func) {
   Key i = nodes_.size();
-  nodes_.emplace_back(std::move(func), [&, i]() { schedule(i); });
+  nodes_.emplace_back(std::move(func));
+  return i;
+}
+
+DAG::Key DAG::addWithStatus(StatusFunc&& func) {
+  Key i = nodes_.size();
+  nodes_.emplace_back(std::move(func));
   return i;
 }
 
@@ -31,14 +44,120 @@ void DAG::dependency(Key a, Key b) {
   nodes_[b].hasPrev = true;
 }
 
-void DAG::schedule(Key i) {
-  for (auto key : nodes_[i].nexts) {
-    if (--nodes_[key].waitCount == 0) {
-      executor_->add([&, key]() {
-        nodes_[key].func();
-        nodes_[key].schedule();
-      });
+void DAG::run(Key i) {
+  bool sink = i == nodes_.size() - 1;
+  execute(i);
+  // the finish callback may destroy the DAG
+  if (!sink) {
+    schedule(i, inlineNext_);
+  }
+}
+
+void DAG::execute(Key i) {
+  if (i == nodes_.size() - 1) {
+    call(i);    // nothing touched after the finish callback
+    return;
+  }
+  bool ok;
+  if (i < timings_.size()) {
+    Timing& timing = timings_[i];
+    timing.threadId = osThreadId();
+    timing.start = timestampNow();
+    ok = call(i);
+    timing.end = timestampNow();
+  } else {
+    ok = call(i);
+  }
+  if (!ok) {
+    failed_.store(true, std::memory_order_release);
+    nodes_[i].cancelled.store(true, std::memory_order_relaxed);
+  }
+}
+
+bool DAG::call(Key i) {
+  Node& node = nodes_[i];
+  try {
+    if (node.statusFunc) {
+      return node.statusFunc();
+    }
+    if (node.func) {
+      node.func();
+    }
+    return true;
+  } catch (const std::exception& e) {
+    ACCLOG(ERROR) << "DAG: func threw unhandled "
+                  << typeid(e).name() << " exception: " << e.what();
+  } catch (...) {
+    ACCLOG(ERROR) << "DAG: func threw unhandled non-exception object";
+  }
+  return false;
+}
+
+bool DAG::shouldSkip(Key i) {
+  if (i == nodes_.size() - 1) {
+    return false;   // the sink always runs
+  }
+  if (nodes_[i].cancelled.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (deadline_ != 0) {
+    if (timedOut_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    if (timestampNow() >= deadline_) {
+      timedOut_.store(true, std::memory_order_release);
+      return true;
+    }
+  }
+  return false;
+}
+
+void DAG::schedule(Key i, bool inlineNext) {
+  // skipped nodes, whose nexts are left to release
+  std::vector<Key> skipped;
+  // kept here, the DAG may be destroyed once the sink ran on any thread
+  const Key none = nodes_.size();
+  const Key sink = none - 1;
+  Key inlined = none;
+  while (true) {
+    bool cancelled = nodes_[i].cancelled.load(std::memory_order_relaxed);
+    for (auto key : nodes_[i].nexts) {
+      if (cancelled) {
+        nodes_[key].cancelled.store(true, std::memory_order_relaxed);
+      }
+      // acq_rel: the last one sees all cancelled stores
+      if (--nodes_[key].waitCount == 0) {
+        if (key < timings_.size()) {
+          timings_[key].ready = timestampNow();
+        }
+        if (shouldSkip(key)) {
+          // released here, without running or going to the executor
+          nodes_[key].cancelled.store(true, std::memory_order_relaxed);
+          skipped.push_back(key);
+          continue;
+        }
+        // the longest ready path stays on this thread
+        if (inlineNext && inlined == none) {
+          inlined = key;
+        } else {
+          executor_->add([&, key]() { run(key); });
+        }
+      }
+    }
+    if (!skipped.empty()) {
+      i = skipped.back();
+      skipped.pop_back();
+      continue;
     }
+    if (inlined == none) {
+      break;
+    }
+    execute(inlined);
+    if (inlined == sink) {
+      return;
+    }
+    i = inlined;
+    inlined = none;
   }
 }
 
@@ -47,6 +166,9 @@ void DAG::go(VoidFunc&& finishCallback) {
     throw std::runtime_error("Cycle in DAG graph");
   }
 
+  if (timing_) {
+    timings_.assign(nodes_.size(), Timing());
+  }
   auto sourceKey = add(nullptr);
   auto sinkKey = add(std::move(finishCallback));
 
@@ -58,7 +180,49 @@ void DAG::go(VoidFunc&& finishCallback) {
       dependency(key, sinkKey);
     }
   }
-  schedule(sourceKey);
+  prioritize();
+  if (timeout_ != 0) {
+    deadline_ = timestampNow() + timeout_;
+  }
+  // not inline, go() returns at once
+  schedule(sourceKey, false);
+}
+
+void DAG::prioritize() {
+  // topological order, by removing the edges from the sources
+  std::vector<size_t> waits(nodes_.size());
+  for (auto& node : nodes_) {
+    for (auto key : node.nexts) {
+      waits[key]++;
+    }
+  }
+  std::vector<Key> order;
+  for (Key key = 0; key < nodes_.size(); key++) {
+    if (waits[key] == 0) {
+      order.push_back(key);
+    }
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    for (auto key : nodes_[order[i]].nexts) {
+      if (--waits[key] == 0) {
+        order.push_back(key);
+      }
+    }
+  }
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    Node& node = nodes_[*it];
+    node.criticalPath = 1;
+    for (auto key : node.nexts) {
+      node.criticalPath =
+        std::max(node.criticalPath, nodes_[key].criticalPath + 1);
+    }
+  }
+  for (auto& node : nodes_) {
+    std::stable_sort(node.nexts.begin(), node.nexts.end(),
+                     [&](Key a, Key b) {
+      return nodes_[a].criticalPath > nodes_[b].criticalPath;
+    });
+  }
 }
 
 bool DAG::hasCycle() {
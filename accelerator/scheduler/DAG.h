@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <stdexcept>
 #include <vector>
@@ -29,16 +30,40 @@ class DAG {
  public:
   typedef size_t Key;
 
+  // Returns false if failed, which cancels the nodes after it.
+  typedef std::function<bool()> StatusFunc;
+
   DAG(std::shared_ptr<Executor> executor)
     : executor_(executor) {}
 
   Key add(VoidFunc&& func);
 
+  // A node which may fail: its downstream nodes are then cancelled, they
+  // do not run but finishCallback is still called. A func throwing is a
+  // failure too.
+  Key addWithStatus(StatusFunc&& func);
+
   // a -> b
   void dependency(Key a, Key b);
 
   void go(VoidFunc&& finishCallback);
 
+  // Cancels the nodes not yet dispatched once timeout (us) passed since
+  // go(), which goes straight to finishCallback. 0 for no timeout.
+  void setTimeout(uint64_t timeout) {
+    timeout_ = timeout;
+  }
+
+  // Some node failed, valid in finishCallback.
+  bool failed() const {
+    return failed_.load(std::memory_order_acquire);
+  }
+
+  // The timeout passed before all nodes were dispatched.
+  bool timedOut() const {
+    return timedOut_.load(std::memory_order_acquire);
+  }
+
   size_t size() const {
     return nodes_.size();
   }
@@ -47,33 +72,80 @@ class DAG {
     return nodes_.empty();
   }
 
+  // Runs one ready successor of a node on the thread which ran the node,
+  // instead of adding it to the executor, on by default.
+  void setInlineNext(bool inlineNext) {
+    inlineNext_ = inlineNext;
+  }
+
+  // Times (us) and thread of a node in go().
+  struct Timing {
+    uint64_t ready{0};      // all its dependencies done
+    uint64_t start{0};
+    uint64_t end{0};
+    uint64_t threadId{0};   // osThreadId()
+  };
+
+  // Records the Timing of each node added in the next go().
+  void enableTiming() {
+    timing_ = true;
+  }
+
+  // By Key, complete once finishCallback is called.
+  const std::vector<Timing>& timings() const {
+    return timings_;
+  }
+
  private:
   struct Node {
-    explicit Node(VoidFunc&& func_, VoidFunc&& schedule_)
-      : func(std::move(func_)),
-        schedule(std::move(schedule_)) {}
+    explicit Node(VoidFunc&& func_)
+      : func(std::move(func_)) {}
+
+    explicit Node(StatusFunc&& statusFunc_)
+      : statusFunc(std::move(statusFunc_)) {}
 
     Node(Node&& node) {
       std::swap(func, node.func);
-      std::swap(schedule, node.schedule);
+      std::swap(statusFunc, node.statusFunc);
       std::swap(nexts, node.nexts);
       hasPrev = node.hasPrev;
+      criticalPath = node.criticalPath;
       waitCount.exchange(node.waitCount.load());
+      cancelled.exchange(node.cancelled.load());
     }
 
     VoidFunc func;
-    VoidFunc schedule;
-    std::vector<Key> nexts;
+    StatusFunc statusFunc;    // instead of func
+    std::vector<Key> nexts;   // by critical path, longest first
     bool hasPrev{false};
+    size_t criticalPath{0};   // nodes on the longest path to the sink
     std::atomic<size_t> waitCount{0};
+    // failed or not run, set before the nexts are released
+    std::atomic<bool> cancelled{false};
   };
 
   bool hasCycle();
 
-  void schedule(Key i);
+  // Sorts the nexts of each node by their critical path.
+  void prioritize();
+
+  void run(Key i);
+  void execute(Key i);
+  bool call(Key i);
+  void schedule(Key i, bool inlineNext);
+
+  // Cancels a ready node, on failure upstream or timeout.
+  bool shouldSkip(Key i);
 
   std::vector<Node> nodes_;
   std::shared_ptr<Executor> executor_;
+  bool inlineNext_{true};
+  bool timing_{false};
+  std::vector<Timing> timings_;   // of the nodes added, not source or sink
+  uint64_t timeout_{0};
+  uint64_t deadline_{0};
+  std::atomic<bool> failed_{false};
+  std::atomic<bool> timedOut_{false};
 };
 
 } // namespace acc
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/scheduler/DAGPlan.h"
+
+#include <algorithm>
+#include <typeinfo>
+
+#include "accelerator/Logging.h"
+
+namespace acc {
+
+DAGPlan::Run::Run(const DAGPlan& plan, Func finish)
+  : plan_(plan),
+    finish_(std::move(finish)),
+    waitCounts_(new std::atomic<size_t>[plan.size()]) {
+  ACCCHECK(plan.compiled()) << "DAGPlan not compiled";
+}
+
+DAGPlan::Key DAGPlan::add(Func&& func) {
+  ACCCHECK(!compiled_) << "DAGPlan already compiled";
+  Key i = funcs_.size();
+  funcs_.push_back(std::move(func));
+  return i;
+}
+
+// a -> b
+void DAGPlan::dependency(Key a, Key b) {
+  ACCCHECK(!compiled_) << "DAGPlan already compiled";
+  ACCCHECK_LT(a, funcs_.size());
+  ACCCHECK_LT(b, funcs_.size());
+  deps_.emplace_back(a, b);
+}
+
+void DAGPlan::compile() {
+  size_t n = funcs_.size();
+  offsets_.assign(n + 1, 0);
+  waitCounts_.assign(n, 0);
+  for (auto& dep : deps_) {
+    offsets_[dep.first + 1]++;
+    waitCounts_[dep.second]++;
+  }
+  for (size_t i = 0; i < n; i++) {
+    offsets_[i + 1] += offsets_[i];
+  }
+  edges_.resize(deps_.size());
+  std::vector<size_t> fill(offsets_.begin(), offsets_.end() - 1);
+  for (auto& dep : deps_) {
+    edges_[fill[dep.first]++] = dep.second;
+  }
+
+  sources_.clear();
+  leafCount_ = 0;
+  for (Key i = 0; i < n; i++) {
+    if (waitCounts_[i] == 0) {
+      sources_.push_back(i);
+    }
+    if (offsets_[i] == offsets_[i + 1]) {
+      leafCount_++;
+    }
+  }
+
+  // all nodes are reached from the sources unless in a cycle
+  std::vector<size_t> waits(waitCounts_);
+  std::vector<Key> order(sources_);
+  for (size_t k = 0; k < order.size(); k++) {
+    Key i = order[k];
+    for (size_t e = offsets_[i]; e < offsets_[i + 1]; e++) {
+      if (--waits[edges_[e]] == 0) {
+        order.push_back(edges_[e]);
+      }
+    }
+  }
+  if (order.size() != n) {
+    throw std::runtime_error("Cycle in DAG graph");
+  }
+
+  // nodes on the longest path to a leaf, in reverse topological order
+  std::vector<size_t> criticalPath(n);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    Key i = *it;
+    criticalPath[i] = 1;
+    for (size_t e = offsets_[i]; e < offsets_[i + 1]; e++) {
+      criticalPath[i] = std::max(criticalPath[i], criticalPath[edges_[e]] + 1);
+    }
+  }
+  auto longer = [&](Key a, Key b) {
+    return criticalPath[a] > criticalPath[b];
+  };
+  for (size_t i = 0; i < n; i++) {
+    std::stable_sort(edges_.begin() + offsets_[i],
+                     edges_.begin() + offsets_[i + 1], longer);
+  }
+  std::stable_sort(sources_.begin(), sources_.end(), longer);
+
+  deps_.clear();
+  deps_.shrink_to_fit();
+  compiled_ = true;
+}
+
+void DAGPlan::go(Run* run, void* context) const {
+  ACCCHECK_EQ(&run->plan_, this);
+  run->context_ = context;
+  if (funcs_.empty()) {
+    run->finish_(context);
+    return;
+  }
+  for (size_t i = 0; i < funcs_.size(); i++) {
+    run->waitCounts_[i].store(waitCounts_[i], std::memory_order_relaxed);
+  }
+  run->leafCount_.store(leafCount_, std::memory_order_relaxed);
+  run->failed_.store(false, std::memory_order_relaxed);
+  // published to the workers by the executor queue
+  for (auto key : sources_) {
+    submit(run, key);
+  }
+}
+
+void DAGPlan::submit(Run* run, Key i) const {
+  // small enough for VoidFunc to hold inline
+  executor_->add([run, i]() { run->plan_.execute(run, i); });
+}
+
+void DAGPlan::execute(Run* run, Key i) const {
+  void* context = run->context_;
+  while (true) {
+    call(run, i);
+    if (offsets_[i] == offsets_[i + 1]) {
+      // the run may be reused once finish is called, not touched after
+      if (run->leafCount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        run->finish_(context);
+      }
+      return;
+    }
+    Key inlined = funcs_.size();
+    for (size_t e = offsets_[i]; e < offsets_[i + 1]; e++) {
+      Key next = edges_[e];
+      if (run->waitCounts_[next].fetch_sub(1, std::memory_order_acq_rel)
+          == 1) {
+        // the longest ready path stays on this thread
+        if (inlineNext_ && inlined == funcs_.size()) {
+          inlined = next;
+        } else {
+          submit(run, next);
+        }
+      }
+    }
+    if (inlined == funcs_.size()) {
+      return;
+    }
+    i = inlined;
+  }
+}
+
+void DAGPlan::call(Run* run, Key i) const {
+  try {
+    funcs_[i](run->context_);
+    return;
+  } catch (const std::exception& e) {
+    ACCLOG(ERROR) << "DAGPlan: func threw unhandled "
+                  << typeid(e).name() << " exception: " << e.what();
+  } catch (...) {
+    ACCLOG(ERROR) << "DAGPlan: func threw unhandled non-exception object";
+  }
+  // seen by finish through the acq_rel of the wait and leaf counts
+  run->failed_.store(true, std::memory_order_relaxed);
+}
+
+} // namespace acc
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "accelerator/concurrency/Executor.h"
+
+namespace acc {
+
+/**
+ * DAG compiled once and run many times, concurrently.
+ *
+ * Nodes and dependencies are added, then compile() checks for cycles and
+ * freezes the graph into CSR arrays (the successors of node i are
+ * edges_[offsets_[i], offsets_[i + 1]), longest critical path first).
+ * A run keeps its state apart in
+ * a Run: the wait counts of the nodes, and a context pointer passed to
+ * every node func. Runs are reused, so a run allocates nothing.
+ *
+ * A func which throws is logged and marks the run failed, the nodes
+ * after it still run and finish is still called.
+ *
+ * Usage:
+ *
+ *   DAGPlan plan(executor);
+ *   auto a = plan.add([](void* ctx) { ... });
+ *   auto b = plan.add([](void* ctx) { ... });
+ *   plan.dependency(a, b);
+ *   plan.compile();
+ *
+ *   DAGPlan::Run run(plan, [](void* ctx) { ... });   // once per slot
+ *   plan.go(&run, &request);                         // per request
+ */
+class DAGPlan {
+ public:
+  typedef size_t Key;
+  typedef std::function<void(void* context)> Func;
+
+  class Run {
+   public:
+    // finish is called with the context once all nodes of a go() ran.
+    Run(const DAGPlan& plan, Func finish);
+
+    Run(const Run&) = delete;
+    Run& operator=(const Run&) = delete;
+
+    void* context() const {
+      return context_;
+    }
+
+    // Some func of the last go() threw, valid in finish.
+    bool failed() const {
+      return failed_.load(std::memory_order_acquire);
+    }
+
+   private:
+    friend class DAGPlan;
+
+    const DAGPlan& plan_;
+    Func finish_;
+    void* context_{nullptr};
+    std::unique_ptr<std::atomic<size_t>[]> waitCounts_;
+    std::atomic<size_t> leafCount_{0};   // leaves not run yet
+    std::atomic<bool> failed_{false};
+  };
+
+  explicit DAGPlan(std::shared_ptr<Executor> executor)
+    : executor_(executor) {}
+
+  Key add(Func&& func);
+
+  // a -> b
+  void dependency(Key a, Key b);
+
+  // Throws std::runtime_error on a cycle. No node or dependency may be
+  // added after.
+  void compile();
+
+  bool compiled() const {
+    return compiled_;
+  }
+
+  // Runs the plan with context on run, which must not be in a go()
+  // already. Returns at once, run is free again when finish is called.
+  void go(Run* run, void* context) const;
+
+  size_t size() const {
+    return funcs_.size();
+  }
+
+  // Runs one ready successor of a node on the thread which ran the node,
+  // instead of adding it to the executor, on by default.
+  void setInlineNext(bool inlineNext) {
+    inlineNext_ = inlineNext;
+  }
+
+  bool empty() const {
+    return funcs_.empty();
+  }
+
+ private:
+  void submit(Run* run, Key i) const;
+  void execute(Run* run, Key i) const;
+  void call(Run* run, Key i) const;
+
+  std::shared_ptr<Executor> executor_;
+  std::vector<Func> funcs_;
+  // dependencies as added, until compile()
+  std::vector<std::pair<Key, Key>> deps_;
+  bool compiled_{false};
+  bool inlineNext_{true};
+
+  // CSR successors
+  std::vector<size_t> offsets_;
+  std::vector<Key> edges_;
+  std::vector<size_t> waitCounts_;  // initial, by node
+  std::vector<Key> sources_;        // longest critical path first
+  size_t leafCount_{0};
+};
+
+} // namespace acc
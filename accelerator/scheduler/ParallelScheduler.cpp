@@ -53,12 +53,31 @@ void ParallelScheduler::add(const std::string& name,
 void ParallelScheduler::run(bool blocking) {
   if (!dag_.empty()) {
     setDependency();
+    VoidFunc finish;
+    if (profile_) {
+      dag_.enableTiming();
+      auto names = std::make_shared<std::vector<std::string>>();
+      for (auto& kv : map_) {
+        if (kv.second >= names->size()) {
+          names->resize(kv.second + 1);
+        }
+        (*names)[kv.second] = kv.first;
+      }
+      auto profile = profile_;
+      auto dag = &dag_;
+      finish = [=]() { profile->add(*names, dag->timings()); };
+    }
     if (blocking) {
-      dag_.go([&]() { waiter_.notify(); });
+      dag_.go([&, finish]() {
+        if (finish) {
+          finish();
+        }
+        waiter_.notify();
+      });
+      waiter_.wait();
     } else {
-      dag_.go(nullptr);
+      dag_.go(std::move(finish));
     }
-    waiter_.wait();
   }
 }
 
@@ -22,6 +22,7 @@
 #include "accelerator/concurrency/ThreadPoolExecutor.h"
 #include "accelerator/scheduler/DAG.h"
 #include "accelerator/scheduler/Graph.h"
+#include "accelerator/scheduler/SchedulerProfile.h"
 #include "accelerator/thread/Waiter.h"
 
 namespace acc {
@@ -56,6 +57,15 @@ class ParallelScheduler {
   void add(const std::string& name,
            const std::vector<std::string>& next);
 
+  // Skips the jobs not yet started once timeout (us) passed, see
+  // DAG::setTimeout().
+  void setTimeout(uint64_t timeout) { dag_.setTimeout(timeout); }
+
+  // Records the node timings of each run into profile, which must
+  // outlive the runs.
+  void setProfile(SchedulerProfile* profile) { profile_ = profile; }
+
+  // Returns at once unless blocking, the jobs then run on the executor.
   void run(bool blocking = false);
 
  private:
@@ -65,6 +75,7 @@ class ParallelScheduler {
   Graph graph_;
   std::map<std::string, DAG::Key> map_;
   bool setup_{false};
+  SchedulerProfile* profile_{nullptr};
   Waiter waiter_;
 };
 
@@ -16,8 +16,6 @@
 
 #include "accelerator/scheduler/PeriodicScheduler.h"
 
-#include "accelerator/Time.h"
-
 namespace acc {
 
 PeriodicScheduler::PeriodicScheduler(
@@ -26,40 +24,29 @@ PeriodicScheduler::PeriodicScheduler(
 }
 
 void PeriodicScheduler::start() {
-  running_ = true;
-  handle_ = std::thread(&PeriodicScheduler::run, this);
+  auto state = state_.wlock();
+  state->scheduler.reset(new ScheduledExecutor(executor_));
+  for (auto& t : state->tasks) {
+    state->scheduler->scheduleAtFixedRate(t.func, 0, t.interval);
+  }
 }
 
 void PeriodicScheduler::stop() {
-  running_ = false;
-  handle_.join();
-}
-
-void PeriodicScheduler::add(acc::VoidFunc&& func, uint64_t interval) {
-  tasks_.wlock()->emplace_back(std::move(func), interval);
-}
-
-void PeriodicScheduler::run() {
-  acc::setCurrentThreadName("AutoTaskThread");
-  timestamp_ = acc::timestampNow();
-  while (running_) {
-    runTasks();
-    usleep(10000); // 10ms
+  std::unique_ptr<ScheduledExecutor> scheduler;
+  {
+    auto state = state_.wlock();
+    scheduler = std::move(state->scheduler);
   }
+  // joins the timer thread outside of the lock
+  scheduler.reset();
 }
 
-void PeriodicScheduler::runTasks() {
-  uint64_t passed = acc::timePassed(timestamp_);
-  auto tasks = tasks_.rlock();
-  for (const auto& t : *tasks) {
-    if (t.checkStamp(passed / t.interval)) {
-      executor_->add(t.func);
-    }
+void PeriodicScheduler::add(acc::VoidFunc&& func, uint64_t interval) {
+  auto state = state_.wlock();
+  if (state->scheduler) {
+    state->scheduler->scheduleAtFixedRate(func, 0, interval);
   }
-}
-
-bool PeriodicScheduler::PeriodicTask::checkStamp(uint64_t st) const {
-  return st >= stamp ? (stamp = st + 1) : false;
+  state->tasks.emplace_back(std::move(func), interval);
 }
 
 } // namespace acc
@@ -16,15 +16,19 @@
 
 #pragma once
 
-#include <atomic>
-#include <thread>
+#include <memory>
 #include <vector>
 
+#include "accelerator/concurrency/ScheduledExecutor.h"
 #include "accelerator/concurrency/ThreadPoolExecutor.h"
 #include "accelerator/thread/Synchronized.h"
 
 namespace acc {
 
+/**
+ * Runs each task added on the executor every interval (us), at fixed
+ * rate from start() or from its add() if added later.
+ */
 class PeriodicScheduler {
  public:
   PeriodicScheduler(std::shared_ptr<ThreadPoolExecutor> executor);
@@ -39,25 +43,19 @@ class PeriodicScheduler {
   struct PeriodicTask {
     acc::VoidFunc func;
     uint64_t interval;
-    mutable uint64_t stamp;
 
     PeriodicTask(acc::VoidFunc&& func_, uint64_t interval_)
       : func(std::move(func_)),
-        interval(interval_),
-        stamp(0) {}
-
-    bool checkStamp(uint64_t st) const;
+        interval(interval_) {}
   };
 
-  void run();
-
-  void runTasks();
+  struct State {
+    std::vector<PeriodicTask> tasks;
+    std::unique_ptr<ScheduledExecutor> scheduler;   // while started
+  };
 
   std::shared_ptr<ThreadPoolExecutor> executor_;
-  std::thread handle_;
-  acc::Synchronized<std::vector<PeriodicTask>> tasks_;
-  std::atomic<bool> running_{false};
-  uint64_t timestamp_{0};
+  acc::Synchronized<State> state_;
 };
 
 } // namespace acc
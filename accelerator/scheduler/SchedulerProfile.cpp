@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "accelerator/scheduler/SchedulerProfile.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "accelerator/String.h"
+#include "accelerator/dynamic.h"
+#include "accelerator/json.h"
+
+namespace acc {
+
+void SchedulerProfile::add(const std::vector<std::string>& names,
+                           const std::vector<DAG::Timing>& timings) {
+  uint64_t n = runs_.fetch_add(1, std::memory_order_relaxed);
+  size_t count = std::min(names.size(), timings.size());
+  bool sampled = traceEvery_ > 0 && n % traceEvery_ == 0;
+
+  std::lock_guard<std::mutex> guard(lock_);
+  for (size_t i = 0; i < count; i++) {
+    auto& t = timings[i];
+    if (names[i].empty() || t.end == 0) {
+      continue;
+    }
+    NodeStats* stats = getNode(names[i]);
+    stats->wait.add(t.start - t.ready);
+    stats->run.add(t.end - t.start);
+  }
+  if (!sampled) {
+    return;
+  }
+
+  uint64_t base = std::numeric_limits<uint64_t>::max();
+  for (size_t i = 0; i < count; i++) {
+    if (timings[i].end != 0) {
+      base = std::min(base, timings[i].ready);
+    }
+  }
+  dynamic events = dynamic::array;
+  for (size_t i = 0; i < count; i++) {
+    auto& t = timings[i];
+    if (names[i].empty() || t.end == 0) {
+      continue;
+    }
+    events.push_back(dynamic::object
+      ("name", names[i])
+      ("ph", "X")
+      ("ts", t.start - base)
+      ("dur", t.end - t.start)
+      ("pid", 0)
+      ("tid", t.threadId)
+      ("args", dynamic::object("wait", t.start - t.ready)));
+  }
+  trace_ = toJson(dynamic::object("traceEvents", std::move(events)));
+}
+
+bool SchedulerProfile::node(const std::string& name, NodeStats& stats) const {
+  stats.wait.clear();
+  stats.run.clear();
+  std::lock_guard<std::mutex> guard(lock_);
+  auto it = nodes_.find(name);
+  if (it == nodes_.end()) {
+    return false;
+  }
+  stats.wait.merge(it->second->wait);
+  stats.run.merge(it->second->run);
+  return true;
+}
+
+std::vector<std::string> SchedulerProfile::nodeNames() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  std::vector<std::string> names;
+  for (auto& kv : nodes_) {
+    names.push_back(kv.first);
+  }
+  return names;
+}
+
+std::string SchedulerProfile::trace() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return trace_;
+}
+
+std::string SchedulerProfile::dump() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  std::string out;
+  for (auto& kv : nodes_) {
+    auto& stats = *kv.second;
+    stringAppendf(&out, "%s: count=%lu wait p50=%lu p99=%lu"
+                  " run p50=%lu p99=%lu\n",
+                  kv.first.c_str(),
+                  stats.run.count(),
+                  stats.wait.percentile(50),
+                  stats.wait.percentile(99),
+                  stats.run.percentile(50),
+                  stats.run.percentile(99));
+  }
+  return out;
+}
+
+SchedulerProfile::NodeStats*
+SchedulerProfile::getNode(const std::string& name) {
+  auto& p = nodes_[name];
+  if (!p) {
+    p.reset(new NodeStats());
+  }
+  return p.get();
+}
+
+} // namespace acc
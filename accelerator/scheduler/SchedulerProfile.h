@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "accelerator/scheduler/DAG.h"
+#include "accelerator/stats/Histogram.h"
+
+namespace acc {
+
+/**
+ * Per-node timing profile of the runs of a graph.
+ *
+ * Each run adds the DAG::Timing of its nodes: the queue wait (from ready
+ * to start) and the run time are aggregated into histograms by node
+ * name. One run in traceEvery is kept as a Chrome trace-event JSON, to
+ * be loaded in chrome://tracing and show the critical path.
+ *
+ * Thread-safe, shared by the ParallelSchedulers of a graph.
+ */
+class SchedulerProfile {
+ public:
+  struct NodeStats {
+    Histogram wait;   // us
+    Histogram run;    // us
+  };
+
+  // traceEvery: keeps the trace of one run in it, 0 for none.
+  explicit SchedulerProfile(uint64_t traceEvery = 0)
+    : traceEvery_(traceEvery) {}
+
+  SchedulerProfile(const SchedulerProfile&) = delete;
+  SchedulerProfile& operator=(const SchedulerProfile&) = delete;
+
+  // Adds a run of the nodes names, by DAG::Key.
+  void add(const std::vector<std::string>& names,
+           const std::vector<DAG::Timing>& timings);
+
+  uint64_t runs() const {
+    return runs_.load(std::memory_order_relaxed);
+  }
+
+  // Copies the stats of the node into stats, false if the node never ran.
+  bool node(const std::string& name, NodeStats& stats) const;
+
+  std::vector<std::string> nodeNames() const;
+
+  // Trace-event JSON of the last sampled run, empty if none.
+  std::string trace() const;
+
+  // One line per node: wait and run p50 / p99.
+  std::string dump() const;
+
+ private:
+  NodeStats* getNode(const std::string& name);
+
+  uint64_t traceEvery_;
+  std::atomic<uint64_t> runs_{0};
+
+  mutable std::mutex lock_;
+  std::map<std::string, std::unique_ptr<NodeStats>> nodes_;
+  std::string trace_;
+};
+
+} // namespace acc
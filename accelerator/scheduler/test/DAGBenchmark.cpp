@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "accelerator/Benchmark.h"
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
+#include "accelerator/scheduler/DAG.h"
+#include "accelerator/scheduler/DAGPlan.h"
+
+using namespace acc;
+
+class InlineExecutor : public Executor {
+ public:
+  void add(VoidFunc func) override {
+    func();
+  }
+};
+
+// Per-run overhead of a graph of size empty nodes, run inline: node i
+// depends on i - 1 and i / 2.
+
+template <class F>
+void forEachDependency(size_t size, F&& func) {
+  for (size_t i = 1; i < size; i++) {
+    func(i - 1, i);
+    if (i / 2 != i - 1) {
+      func(i / 2, i);
+    }
+  }
+}
+
+void rebuildDAG(unsigned n, size_t size) {
+  auto executor = std::make_shared<InlineExecutor>();
+  unsigned finished = 0;
+  for (unsigned i = 0; i < n; i++) {
+    DAG dag(executor);
+    for (size_t k = 0; k < size; k++) {
+      dag.add([]() {});
+    }
+    forEachDependency(size, [&](size_t a, size_t b) { dag.dependency(a, b); });
+    dag.go([&]() { finished++; });
+  }
+  doNotOptimizeAway(finished);
+}
+
+void compiledPlan(unsigned n, size_t size) {
+  std::unique_ptr<DAGPlan> plan;
+  std::unique_ptr<DAGPlan::Run> run;
+  unsigned finished = 0;
+  BENCHMARK_SUSPEND {
+    plan.reset(new DAGPlan(std::make_shared<InlineExecutor>()));
+    for (size_t k = 0; k < size; k++) {
+      plan->add([](void*) {});
+    }
+    forEachDependency(size, [&](size_t a, size_t b) {
+      plan->dependency(a, b);
+    });
+    plan->compile();
+    run.reset(new DAGPlan::Run(*plan, [](void* ctx) {
+      (*static_cast<unsigned*>(ctx))++;
+    }));
+  }
+  for (unsigned i = 0; i < n; i++) {
+    plan->go(run.get(), &finished);
+  }
+  doNotOptimizeAway(finished);
+}
+
+// Latency of a run on 4 threads, waited for after each go(), with one
+// ready successor run inline or all added to the pool: a chain of size
+// nodes, and a fan-out of size nodes between a source and a sink.
+
+void poolRun(unsigned n, bool inlineNext, size_t size, bool chain) {
+  std::shared_ptr<CPUThreadPoolExecutor> pool;
+  std::unique_ptr<DAGPlan> plan;
+  std::unique_ptr<DAGPlan::Run> run;
+  std::atomic<unsigned> finished(0);
+  BENCHMARK_SUSPEND {
+    pool = std::make_shared<CPUThreadPoolExecutor>(4);
+    plan.reset(new DAGPlan(pool));
+    plan->setInlineNext(inlineNext);
+    for (size_t k = 0; k < size; k++) {
+      plan->add([](void*) {});
+    }
+    for (size_t k = 1; k < size; k++) {
+      if (chain) {
+        plan->dependency(k - 1, k);
+      } else if (k < size - 1) {
+        plan->dependency(0, k);
+        plan->dependency(k, size - 1);
+      }
+    }
+    plan->compile();
+    run.reset(new DAGPlan::Run(*plan, [&](void*) { finished++; }));
+  }
+  for (unsigned i = 0; i < n; i++) {
+    plan->go(run.get(), nullptr);
+    while (finished.load(std::memory_order_acquire) <= i) {
+      std::this_thread::yield();
+    }
+  }
+  BENCHMARK_SUSPEND {
+    pool->join();
+  }
+}
+
+void chain(unsigned n, bool inlineNext, size_t size) {
+  poolRun(n, inlineNext, size, true);
+}
+
+void fanOut(unsigned n, bool inlineNext, size_t size) {
+  poolRun(n, inlineNext, size, false);
+}
+
+// sudo nice -n -20 ./accelerator/scheduler/test/accelerator_scheduler_DAGBenchmark -bm_min_iters 10000
+// ============================================================================
+// DAGBenchmark.cpp                                relative  time/iter  iters/s
+// ============================================================================
+// rebuildDAG(10_nodes)                                         2.07us  483.60K
+// compiledPlan(10_nodes)                          1495.51%   138.27ns    7.23M
+// ----------------------------------------------------------------------------
+// rebuildDAG(100_nodes)                                       24.35us   41.07K
+// compiledPlan(100_nodes)                         1568.40%     1.55us  644.22K
+// ----------------------------------------------------------------------------
+// rebuildDAG(1000_nodes)                                     255.91us    3.91K
+// compiledPlan(1000_nodes)                        1682.00%    15.21us   65.73K
+// ----------------------------------------------------------------------------
+// chain(pool_10_nodes)                                         7.58us  131.87K
+// chain(inline_10_nodes)                           305.70%     2.48us  403.13K
+// chain(pool_100_nodes)                                       40.95us   24.42K
+// chain(inline_100_nodes)                         1310.01%     3.13us  319.90K
+// ----------------------------------------------------------------------------
+// fanOut(pool_10_nodes)                                       22.07us   45.32K
+// fanOut(inline_10_nodes)                          134.59%    16.39us   60.99K
+// fanOut(pool_100_nodes)                                     139.27us    7.18K
+// fanOut(inline_100_nodes)                         116.89%   119.15us    8.39K
+// ============================================================================
+
+BENCHMARK_NAMED_PARAM(rebuildDAG, 10_nodes, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(compiledPlan, 10_nodes, 10)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(rebuildDAG, 100_nodes, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(compiledPlan, 100_nodes, 100)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(rebuildDAG, 1000_nodes, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(compiledPlan, 1000_nodes, 1000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(chain, pool_10_nodes, false, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(chain, inline_10_nodes, true, 10)
+BENCHMARK_NAMED_PARAM(chain, pool_100_nodes, false, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(chain, inline_100_nodes, true, 100)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(fanOut, pool_10_nodes, false, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(fanOut, inline_10_nodes, true, 10)
+BENCHMARK_NAMED_PARAM(fanOut, pool_100_nodes, false, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(fanOut, inline_100_nodes, true, 100)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  acc::runBenchmarks();
+  return 0;
+}
@@ -14,11 +14,21 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "accelerator/String.h"
+#include "accelerator/json.h"
+#include "accelerator/concurrency/CPUThreadPoolExecutor.h"
 #include "accelerator/scheduler/DAG.h"
+#include "accelerator/scheduler/DAGPlan.h"
+#include "accelerator/scheduler/ParallelScheduler.h"
+#include "accelerator/scheduler/SchedulerProfile.h"
 
 using namespace acc;
 
@@ -57,3 +67,298 @@ TEST(DAG, all) {
   dag.go(std::bind(run, 5, &out));
   EXPECT_STREQ("0 1 3 2 4 5 ", out.c_str());
 }
+
+TEST(DAG, criticalPath) {
+  DAG dag(std::shared_ptr<Executor>(new InlineExecutor()));
+  std::string out;
+
+  for (int i = 0; i < 4; i++) {
+    dag.add(std::bind(run, i, &out));
+  }
+  // 0, 1 -> 2 -> 3: the longer chain of 1 goes first
+  dag.dependency(1, 2);
+  dag.dependency(2, 3);
+
+  dag.go(std::bind(run, 5, &out));
+  EXPECT_STREQ("1 2 3 0 5 ", out.c_str());
+}
+
+TEST(DAG, inlineNext) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(4);
+  const int kChain = 16;
+  std::vector<std::thread::id> threads(kChain);
+  std::atomic<bool> finished(false);
+  {
+    DAG dag(pool);
+    for (int i = 0; i < kChain; i++) {
+      dag.add([&, i]() { threads[i] = std::this_thread::get_id(); });
+      if (i > 0) {
+        dag.dependency(i - 1, i);
+      }
+    }
+    dag.go([&]() { finished = true; });
+    while (!finished) {
+      std::this_thread::yield();
+    }
+    pool->join();
+  }
+  // the chain stays on the worker which started it
+  for (int i = 1; i < kChain; i++) {
+    EXPECT_EQ(threads[0], threads[i]);
+  }
+}
+
+TEST(DAG, failure) {
+  DAG dag(std::shared_ptr<Executor>(new InlineExecutor()));
+  std::string out;
+
+  dag.add(std::bind(run, 0, &out));
+  dag.addWithStatus([&]() { run(1, &out); return false; });
+  dag.add(std::bind(run, 2, &out));
+  dag.add(std::bind(run, 3, &out));
+  dag.add([&]() { run(4, &out); throw std::runtime_error("4"); });
+  dag.add(std::bind(run, 5, &out));
+  // 0 -> 2, 1 -> 2 -> 3: 1 fails, cancels 2 and 3
+  // 4 -> 5: 4 throws, cancels 5
+  dag.dependency(0, 2);
+  dag.dependency(1, 2);
+  dag.dependency(2, 3);
+  dag.dependency(4, 5);
+
+  dag.go([&]() { run(dag.failed() ? -1 : 6, &out); });
+  EXPECT_STREQ("0 1 4 -1 ", out.c_str());
+  EXPECT_FALSE(dag.timedOut());
+}
+
+TEST(DAG, timeout) {
+  DAG dag(std::shared_ptr<Executor>(new InlineExecutor()));
+  std::string out;
+
+  dag.add([&]() {
+    run(0, &out);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  });
+  dag.add(std::bind(run, 1, &out));
+  dag.add(std::bind(run, 2, &out));
+  dag.dependency(0, 1);
+  dag.dependency(0, 2);
+  dag.setTimeout(1000);
+
+  dag.go([&]() { run(dag.timedOut() ? -1 : 3, &out); });
+  EXPECT_STREQ("0 -1 ", out.c_str());
+  EXPECT_FALSE(dag.failed());
+}
+
+TEST(DAG, failedChain) {
+  DAG dag(std::shared_ptr<Executor>(new InlineExecutor()));
+  const int kChain = 100000;
+  std::atomic<int> ran(0);
+  dag.addWithStatus([]() { return false; });
+  for (int i = 1; i < kChain; i++) {
+    dag.add([&]() { ran++; });
+    dag.dependency(i - 1, i);
+  }
+  bool finished = false;
+
+  // skipped in a loop, a recursion per node would overflow the stack
+  dag.go([&]() { finished = true; });
+  EXPECT_TRUE(finished);
+  EXPECT_TRUE(dag.failed());
+  EXPECT_EQ(0, ran);
+}
+
+TEST(DAG, deleteInFinish) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(4);
+  std::atomic<int> finished(0);
+  const int kRuns = 100;
+  for (int r = 0; r < kRuns; r++) {
+    DAG* dag = new DAG(pool);
+    // the sink is reached inline, and from several leaves
+    for (int i = 0; i < 8; i++) {
+      dag->add([]() {});
+      if (i > 0 && i % 2 == 0) {
+        dag->dependency(i - 1, i);
+      }
+    }
+    dag->go([dag, &finished]() {
+      // the callback is destroyed with the DAG, its captures too
+      std::atomic<int>* count = &finished;
+      delete dag;
+      (*count)++;
+    });
+  }
+  while (finished < kRuns) {
+    std::this_thread::yield();
+  }
+  pool->join();
+}
+
+TEST(DAG, timing) {
+  DAG dag(std::shared_ptr<Executor>(new InlineExecutor()));
+  dag.add([]() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+  dag.add(nullptr);
+  dag.dependency(0, 1);
+  dag.enableTiming();
+
+  dag.go(nullptr);
+  auto& timings = dag.timings();
+  ASSERT_EQ(2, timings.size());
+  EXPECT_LE(timings[0].ready, timings[0].start);
+  EXPECT_LE(2000, timings[0].end - timings[0].start);
+  EXPECT_LE(timings[0].end, timings[1].ready);
+  EXPECT_NE(0, timings[1].threadId);
+}
+
+TEST(SchedulerProfile, parallelScheduler) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(2);
+  SchedulerProfile profile(1);
+  // kept until join: the worker still leaves the sink after notify
+  std::vector<std::unique_ptr<ParallelScheduler>> schedulers;
+  for (int i = 0; i < 3; i++) {
+    schedulers.emplace_back(new ParallelScheduler(pool));
+    auto& scheduler = *schedulers.back();
+    scheduler.add("a", {"c"}, []() {});
+    scheduler.add("b", {"c"}, []() {});
+    scheduler.add("c", {}, []() {});
+    scheduler.setProfile(&profile);
+    scheduler.run(true);
+  }
+  pool->join();
+
+  EXPECT_EQ(3, profile.runs());
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), profile.nodeNames());
+  SchedulerProfile::NodeStats stats;
+  ASSERT_TRUE(profile.node("c", stats));
+  EXPECT_EQ(3, stats.run.count());
+  EXPECT_EQ(3, stats.wait.count());
+  EXPECT_FALSE(profile.node("d", stats));
+  EXPECT_EQ(0, stats.run.count());
+
+  auto trace = parseJson(profile.trace());
+  ASSERT_EQ(3, trace["traceEvents"].size());
+  for (auto& event : trace["traceEvents"]) {
+    EXPECT_EQ("X", event["ph"].asString());
+    EXPECT_LE(0, event["ts"].asInt());
+  }
+}
+
+TEST(ParallelScheduler, nonBlocking) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(2);
+  std::atomic<int> done(0);
+  {
+    ParallelScheduler scheduler(pool);
+    scheduler.add("a", {"b"}, [&]() { done++; });
+    scheduler.add("b", {}, [&]() { done++; });
+    // returns without a notify from the sink
+    scheduler.run(false);
+    while (done < 2) {
+      std::this_thread::yield();
+    }
+    pool->join();
+  }
+  EXPECT_EQ(2, done);
+}
+
+TEST(DAGPlan, all) {
+  DAGPlan plan(std::shared_ptr<Executor>(new InlineExecutor()));
+  for (int i = 0; i < 5; i++) {
+    plan.add([i](void* ctx) { run(i, static_cast<std::string*>(ctx)); });
+  }
+  plan.dependency(0, 3);
+  plan.dependency(1, 3);
+  plan.dependency(2, 4);
+  plan.dependency(3, 4);
+  plan.compile();
+
+  DAGPlan::Run r(plan, [](void* ctx) {
+    run(5, static_cast<std::string*>(ctx));
+  });
+  // reused
+  for (int i = 0; i < 3; i++) {
+    std::string out;
+    plan.go(&r, &out);
+    EXPECT_STREQ("0 1 3 2 4 5 ", out.c_str());
+  }
+}
+
+TEST(DAGPlan, cycle) {
+  DAGPlan plan(std::shared_ptr<Executor>(new InlineExecutor()));
+  plan.add(nullptr);
+  plan.add(nullptr);
+  plan.add(nullptr);
+  plan.dependency(0, 1);
+  plan.dependency(1, 2);
+  plan.dependency(2, 1);
+  EXPECT_THROW(plan.compile(), std::runtime_error);
+}
+
+TEST(DAGPlan, failure) {
+  DAGPlan plan(std::shared_ptr<Executor>(new InlineExecutor()));
+  bool fail = true;
+  plan.add([](void* ctx) { run(0, static_cast<std::string*>(ctx)); });
+  plan.add([&](void* ctx) {
+    if (fail) {
+      throw std::runtime_error("plan");
+    }
+    run(1, static_cast<std::string*>(ctx));
+  });
+  plan.add([](void* ctx) { run(2, static_cast<std::string*>(ctx)); });
+  plan.dependency(0, 1);
+  plan.dependency(1, 2);
+  plan.compile();
+
+  bool failed = false;
+  DAGPlan::Run r(plan, [&](void*) { failed = r.failed(); });
+  std::string out;
+  // the nodes after the failed one still run, and finish is called
+  plan.go(&r, &out);
+  EXPECT_STREQ("0 2 ", out.c_str());
+  EXPECT_TRUE(failed);
+  fail = false;
+  out.clear();
+  plan.go(&r, &out);
+  EXPECT_STREQ("0 1 2 ", out.c_str());
+  EXPECT_FALSE(failed);
+}
+
+TEST(DAGPlan, concurrent) {
+  auto pool = std::make_shared<CPUThreadPoolExecutor>(4);
+  DAGPlan plan(pool);
+  // diamond layers: 0 -> [1..8] -> 9
+  plan.add([](void* ctx) { static_cast<std::atomic<int>*>(ctx)[0]++; });
+  for (int i = 1; i <= 8; i++) {
+    plan.add([](void* ctx) { static_cast<std::atomic<int>*>(ctx)[1]++; });
+    plan.dependency(0, i);
+  }
+  plan.add([](void* ctx) {
+    auto counts = static_cast<std::atomic<int>*>(ctx);
+    // all predecessors ran
+    EXPECT_EQ(8, counts[1].load());
+    counts[2]++;
+  });
+  for (int i = 1; i <= 8; i++) {
+    plan.dependency(i, 9);
+  }
+  plan.compile();
+
+  const int kRuns = 16;
+  std::atomic<int> counts[kRuns][3];
+  std::atomic<int> finished(0);
+  std::vector<std::unique_ptr<DAGPlan::Run>> runs;
+  for (int i = 0; i < kRuns; i++) {
+    for (auto& c : counts[i]) {
+      c = 0;
+    }
+    runs.emplace_back(new DAGPlan::Run(plan, [&](void*) { finished++; }));
+    plan.go(runs.back().get(), counts[i]);
+  }
+  while (finished < kRuns) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < kRuns; i++) {
+    EXPECT_EQ(1, counts[i][0]);
+    EXPECT_EQ(8, counts[i][1]);
+    EXPECT_EQ(1, counts[i][2]);
+  }
+  pool->join();
+}
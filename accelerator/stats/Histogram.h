@@ -0,0 +1,118 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "accelerator/Bits.h"
+
+namespace acc {
+
+/**
+ * Lock-free histogram of unsigned values, such as latencies.
+ *
+ * Values are bucketed by their highest set bit and the kSubBits bits
+ * below it, so percentile() is within 1 / 2^kSubBits of the real value
+ * whatever the magnitude. add() is wait-free and thread-safe, readers
+ * may run concurrently with writers.
+ */
+class Histogram {
+ public:
+  static constexpr int kSubBits = 2;
+  static constexpr size_t kSubBuckets = 1 << kSubBits;
+  static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+  Histogram() {
+    clear();
+  }
+
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  void add(uint64_t value) {
+    buckets_[index(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    uint64_t n = 0;
+    for (auto& b : buckets_) {
+      n += b.load(std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // Returns the upper bound of the bucket holding the p-th percentile,
+  // 0 < p <= 100, or 0 if empty.
+  uint64_t percentile(double p) const {
+    uint64_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+    uint64_t rank = total * p / 100;
+    if (rank == 0) {
+      rank = 1;
+    }
+    uint64_t n = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+      n += buckets_[i].load(std::memory_order_relaxed);
+      if (n >= rank) {
+        return upperBound(i);
+      }
+    }
+    return upperBound(kBuckets - 1);
+  }
+
+  // Adds the counts of other, a snapshot if other is being added to.
+  void merge(const Histogram& other) {
+    for (size_t i = 0; i < kBuckets; i++) {
+      buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+    }
+  }
+
+  void clear() {
+    for (auto& b : buckets_) {
+      b.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  static size_t index(uint64_t value) {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    int msb = findLastSet(value) - 1;
+    size_t sub = (value >> (msb - kSubBits)) & (kSubBuckets - 1);
+    return (msb - kSubBits + 1) * kSubBuckets + sub;
+  }
+
+  static uint64_t upperBound(size_t index) {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    int msb = index / kSubBuckets + kSubBits - 1;
+    uint64_t width = uint64_t(1) << (msb - kSubBits);
+    uint64_t lower = (uint64_t(1) << msb) | (index % kSubBuckets) * width;
+    return lower + (width - 1);
+  }
+
+ private:
+  std::atomic<uint64_t> buckets_[kBuckets];
+};
+
+} // namespace acc
@@ -40,16 +40,38 @@ void MonitorValue::init(Type type) {
 }
 
 void MonitorValue::reset() {
-  isset_ = type_ & (CNT | SUM);
   count_ = 0;
-  value_ = 0;
+  value_ = initialValue();
+}
+
+bool MonitorValue::isSet() const {
+  switch (type_) {
+    case CNT:
+    case SUM: return true;
+    case AVG: return count_ != 0;
+    case MIN:
+    case MAX: return value_ != initialValue();
+    default: return false;
+  }
 }
 
 void MonitorValue::add(int64_t value) {
-  isset_ = true;
   switch (type_) {
     case CNT:
-    case AVG: count_++;
+    case AVG: count_.fetch_add(1, std::memory_order_relaxed);
+    case SUM: value_.fetch_add(value, std::memory_order_relaxed); break;
+    case MIN: detail::updateMin(value_, value); break;
+    case MAX: detail::updateMax(value_, value); break;
+    default: break;
+  }
+}
+
+void MonitorValue::drain(MonitorValue& other) {
+  int64_t count = other.count_.exchange(0);
+  int64_t value = other.value_.exchange(other.initialValue());
+  switch (type_) {
+    case CNT:
+    case AVG: count_ += count;
     case SUM: value_ += value; break;
     case MIN: detail::updateMin(value_, value); break;
     case MAX: detail::updateMax(value_, value); break;
@@ -61,7 +83,7 @@ int64_t MonitorValue::value() const {
   switch (type_) {
     case CNT: return count_;
     case AVG: {
-      int32_t n = count_;
+      int64_t n = count_;
       return n != 0 ? value_ / n : 0;
     }
     case MIN:
@@ -18,6 +18,8 @@
 
 #include <algorithm>
 #include <array>
+#include <limits>
+#include <memory>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -26,6 +28,7 @@
 #include "accelerator/Logging.h"
 #include "accelerator/Singleton.h"
 #include "accelerator/Time.h"
+#include "accelerator/thread/CacheLocality.h"
 #include "accelerator/thread/ThreadUtil.h"
 
 namespace acc {
@@ -50,18 +53,27 @@ class MonitorValue {
   Type type() const {
     return type_;
   }
-  bool isSet() const {
-    return isset_;
-  }
+  bool isSet() const;
 
   void add(int64_t value = 0);
 
+  // Moves the value of other, of the same type, into this and resets
+  // other. An add racing with it may be counted in the next drain.
+  void drain(MonitorValue& other);
+
   int64_t value() const;
 
  private:
+  int64_t initialValue() const {
+    switch (type_) {
+      case MIN: return std::numeric_limits<int64_t>::max();
+      case MAX: return std::numeric_limits<int64_t>::min();
+      default: return 0;
+    }
+  }
+
   Type type_;
-  std::atomic<bool> isset_;
-  std::atomic<int32_t> count_;
+  std::atomic<int64_t> count_;
   std::atomic<int64_t> value_;
 };
 
@@ -95,34 +107,50 @@ class MonitorBase {
   std::atomic<bool> open_{false};
 };
 
+/**
+ * The values are striped by cpu with AccessSpreader, so threads on
+ * different cpus add to different cache lines, and merged in dump().
+ */
 template <class T>
 class Monitor : public MonitorBase {
  public:
-  Monitor() {
-    for (int key = 0; key < T::kMax; key++) {
-      mvalues_[key].init(T::getType(key));
+  Monitor()
+    : numStripes_(CacheLocality::system().numCpus),
+      stripes_(new Stripe[numStripes_]) {
+    for (size_t i = 0; i < numStripes_; i++) {
+      for (int key = 0; key < T::kMax; key++) {
+        stripes_[i].mvalues[key].init(T::getType(key));
+      }
     }
   }
 
   void addToMonitor(int key, int64_t value = 0) override {
     if (open_) {
-      mvalues_[key].add(value);
+      stripes_[AccessSpreader::current(numStripes_)].mvalues[key].add(value);
     }
   }
 
  private:
+  struct Stripe {
+    std::array<MonitorValue, T::kMax> mvalues;
+    char padding[CacheLocality::kFalseSharingRange];
+  };
+
   void dump(Data& data) override {
-    int key = 0;
-    for (auto& m : mvalues_) {
+    for (int key = 0; key < T::kMax; key++) {
+      MonitorValue m;
+      m.init(T::getType(key));
+      for (size_t i = 0; i < numStripes_; i++) {
+        m.drain(stripes_[i].mvalues[key]);
+      }
       if (m.isSet()) {
         data[prefix_ + T::getName(key)] = m.value();
-        m.reset();
       }
-      key++;
     }
   }
 
-  std::array<MonitorValue, T::kMax> mvalues_;
+  size_t numStripes_;
+  std::unique_ptr<Stripe[]> stripes_;
 };
 
 template <class T, class F>
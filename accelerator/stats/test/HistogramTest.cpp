@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+#include <gtest/gtest.h>
+
+#include "accelerator/stats/Histogram.h"
+
+using namespace acc;
+
+TEST(Histogram, buckets) {
+  size_t buckets = Histogram::kBuckets;
+  for (uint64_t v = 0; v < 100000; v++) {
+    size_t i = Histogram::index(v);
+    ASSERT_LT(i, buckets);
+    ASSERT_LE(v, Histogram::upperBound(i));
+    if (i > 0) {
+      ASSERT_GT(v, Histogram::upperBound(i - 1));
+    }
+  }
+  uint64_t max = std::numeric_limits<uint64_t>::max();
+  EXPECT_EQ(buckets - 1, Histogram::index(max));
+  EXPECT_EQ(max, Histogram::upperBound(buckets - 1));
+}
+
+TEST(Histogram, percentile) {
+  Histogram h;
+  EXPECT_EQ(0, h.count());
+  EXPECT_EQ(0, h.percentile(99));
+
+  for (uint64_t v = 1; v <= 1000; v++) {
+    h.add(v);
+  }
+  EXPECT_EQ(1000, h.count());
+  // within 1/4 of the real value
+  EXPECT_LE(500, h.percentile(50));
+  EXPECT_GE(625, h.percentile(50));
+  EXPECT_LE(990, h.percentile(99));
+  EXPECT_GE(1238, h.percentile(99));
+  EXPECT_LE(1000, h.percentile(100));
+
+  h.clear();
+  EXPECT_EQ(0, h.count());
+}
+
+TEST(Histogram, merge) {
+  Histogram a, b;
+  for (uint64_t v = 1; v <= 100; v++) {
+    a.add(v);
+    b.add(v * 100);
+  }
+  Histogram c;
+  c.merge(a);
+  EXPECT_EQ(100, c.count());
+  EXPECT_EQ(a.percentile(99), c.percentile(99));
+  c.merge(b);
+  EXPECT_EQ(200, c.count());
+  EXPECT_EQ(b.percentile(99), c.percentile(99));
+}
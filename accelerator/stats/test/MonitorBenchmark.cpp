@@ -14,21 +14,99 @@
  * limitations under the License.
  */
 
+#include <array>
+#include <thread>
+#include <vector>
+
 #include "accelerator/Benchmark.h"
 #include "accelerator/Portability.h"
 #include "accelerator/stats/test/MonitorTest.h"
 
 using namespace acc;
 
-// sudo nice -n -20 ./accelerator/stats/test/accelerator_stats_MonitorBenchmark -bm_min_iters 10000000
+// n adds spread over threads, to one MonitorValue array shared by all
+// threads (the layout before striping), or to the Monitor striped by cpu.
+
+std::array<MonitorValue, TestMonitorKey::kMax> shared;
+
+template <class F>
+void addOnThreads(unsigned n, size_t threads, F&& add) {
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      for (unsigned i = t; i < n; i += threads) {
+        add(i);
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void sharedCnt(unsigned n, size_t threads) {
+  addOnThreads(n, threads, [](unsigned) {
+    shared[TestMonitorKey::kTestCnt].add();
+  });
+}
+
+void stripedCnt(unsigned n, size_t threads) {
+  addOnThreads(n, threads, [](unsigned) {
+    ACCMON_CNT(TestMonitorKey, kTestCnt);
+  });
+}
+
+void sharedMax(unsigned n, size_t threads) {
+  addOnThreads(n, threads, [](unsigned i) {
+    shared[TestMonitorKey::kTestMax].add(i);
+  });
+}
+
+void stripedMax(unsigned n, size_t threads) {
+  addOnThreads(n, threads, [](unsigned i) {
+    ACCMON_ADD(TestMonitorKey, kTestMax, i);
+  });
+}
+
+// sudo nice -n -20 ./accelerator/stats/test/accelerator_stats_MonitorBenchmark -bm_min_iters 1000000
 // ============================================================================
 // MonitorBenchmark.cpp                            relative  time/iter  iters/s
 // ============================================================================
-// addToMonitor_cnt                                             1.29ns  775.89M
-// addToMonitor_min                                             1.30ns  769.71M
-// addToMonitor_max                                             1.36ns  735.51M
-// addToMonitor_avg                                             1.29ns  776.01M
-// addToMonitor_sum                                             1.36ns  735.49M
+// addToMonitor_cnt                                            21.32ns   46.91M
+// addToMonitor_min                                             9.43ns  106.05M
+// addToMonitor_max                                             8.40ns  119.11M
+// addToMonitor_avg                                            21.27ns   47.00M
+// addToMonitor_sum                                            13.12ns   76.19M
+// ----------------------------------------------------------------------------
+// sharedCnt(1_thread)                                         15.52ns   64.45M
+// stripedCnt(1_thread)                             107.21%    14.47ns   69.10M
+// sharedCnt(2_threads)                                        12.06ns   82.95M
+// stripedCnt(2_threads)                             69.07%    17.45ns   57.30M
+// sharedCnt(4_threads)                                        12.34ns   81.02M
+// stripedCnt(4_threads)                             85.47%    14.44ns   69.24M
+// sharedCnt(8_threads)                                        12.25ns   81.60M
+// stripedCnt(8_threads)                             84.96%    14.42ns   69.33M
+// sharedCnt(16_threads)                                       12.31ns   81.24M
+// stripedCnt(16_threads)                            80.95%    15.21ns   65.76M
+// sharedCnt(32_threads)                                       14.25ns   70.16M
+// stripedCnt(32_threads)                            90.41%    15.76ns   63.43M
+// sharedCnt(64_threads)                                       14.85ns   67.32M
+// stripedCnt(64_threads)                            84.96%    17.48ns   57.20M
+// ----------------------------------------------------------------------------
+// sharedMax(1_thread)                                        825.26ps    1.21G
+// stripedMax(1_thread)                              15.50%     5.33ns  187.76M
+// sharedMax(2_threads)                                         1.02ns  977.12M
+// stripedMax(2_threads)                             19.18%     5.34ns  187.42M
+// sharedMax(4_threads)                                         1.13ns  884.92M
+// stripedMax(4_threads)                             19.24%     5.87ns  170.28M
+// sharedMax(8_threads)                                         1.13ns  884.39M
+// stripedMax(8_threads)                             19.68%     5.74ns  174.08M
+// sharedMax(16_threads)                                        1.21ns  829.47M
+// stripedMax(16_threads)                            20.55%     5.87ns  170.48M
+// sharedMax(32_threads)                                        1.75ns  572.77M
+// stripedMax(32_threads)                            28.21%     6.19ns  161.60M
+// sharedMax(64_threads)                                        2.78ns  359.95M
+// stripedMax(64_threads)                            42.89%     6.48ns  154.37M
 // ============================================================================
 
 BENCHMARK(addToMonitor_cnt, n) {
@@ -61,8 +139,46 @@ BENCHMARK(addToMonitor_sum, n) {
   }
 }
 
+BENCHMARK_DRAW_LINE()
+BENCHMARK_NAMED_PARAM(sharedCnt, 1_thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 1_thread, 1)
+BENCHMARK_NAMED_PARAM(sharedCnt, 2_threads, 2)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 2_threads, 2)
+BENCHMARK_NAMED_PARAM(sharedCnt, 4_threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 4_threads, 4)
+BENCHMARK_NAMED_PARAM(sharedCnt, 8_threads, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 8_threads, 8)
+BENCHMARK_NAMED_PARAM(sharedCnt, 16_threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 16_threads, 16)
+BENCHMARK_NAMED_PARAM(sharedCnt, 32_threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 32_threads, 32)
+BENCHMARK_NAMED_PARAM(sharedCnt, 64_threads, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedCnt, 64_threads, 64)
+BENCHMARK_DRAW_LINE()
+BENCHMARK_NAMED_PARAM(sharedMax, 1_thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 1_thread, 1)
+BENCHMARK_NAMED_PARAM(sharedMax, 2_threads, 2)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 2_threads, 2)
+BENCHMARK_NAMED_PARAM(sharedMax, 4_threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 4_threads, 4)
+BENCHMARK_NAMED_PARAM(sharedMax, 8_threads, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 8_threads, 8)
+BENCHMARK_NAMED_PARAM(sharedMax, 16_threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 16_threads, 16)
+BENCHMARK_NAMED_PARAM(sharedMax, 32_threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 32_threads, 32)
+BENCHMARK_NAMED_PARAM(sharedMax, 64_threads, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(stripedMax, 64_threads, 64)
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
+  for (int key = 0; key < TestMonitorKey::kMax; key++) {
+    shared[key].init(TestMonitorKey::getType(key));
+  }
+  setupMonitor<TestMonitorKey>("", [](const MonitorBase::Data&) {});
+  while (!Singleton<Monitor<TestMonitorKey>>::get()->running()) {
+    std::this_thread::yield();
+  }
   acc::runBenchmarks();
   return 0;
 }
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "accelerator/stats/test/MonitorTest.h"
@@ -30,3 +32,54 @@ TEST(monitor, all) {
   ACCMON_ADD(TestMonitorKey, kTestAvg, 20);
 }
 
+
+TEST(MonitorValue, drain) {
+  const int kThreads = 4;
+  MonitorValue stripes[kThreads];
+  for (auto& m : stripes) {
+    m.init(MonitorValue::AVG);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 1; i <= 1000; i++) {
+        stripes[t].add(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  MonitorValue m;
+  m.init(MonitorValue::AVG);
+  for (auto& stripe : stripes) {
+    m.drain(stripe);
+    EXPECT_FALSE(stripe.isSet());
+  }
+  EXPECT_TRUE(m.isSet());
+  EXPECT_EQ(500, m.value());
+}
+
+TEST(MonitorValue, minMax) {
+  MonitorValue min, max, stripe;
+  min.init(MonitorValue::MIN);
+  max.init(MonitorValue::MAX);
+  EXPECT_FALSE(min.isSet());
+  EXPECT_FALSE(max.isSet());
+
+  stripe.init(MonitorValue::MIN);
+  stripe.add(20);
+  stripe.add(10);
+  min.drain(stripe);
+  stripe.add(30);
+  min.drain(stripe);
+  EXPECT_EQ(10, min.value());
+
+  stripe.init(MonitorValue::MAX);
+  stripe.add(-20);
+  stripe.add(-10);
+  max.drain(stripe);
+  max.drain(stripe);
+  EXPECT_EQ(-10, max.value());
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include "accelerator/Benchmark.h"
+#include "accelerator/Portability.h"
+#include "accelerator/Random.h"
+#include "accelerator/TimedHeap.h"
+#include "accelerator/TimingWheel.h"
+
+using namespace acc;
+
+struct Item {
+  TimingWheelHook<Item> hook;
+};
+
+typedef TimingWheel<Item, &Item::hook> ItemWheel;
+
+// Each round arms every timer, re-arms it once (as a read after connect
+// does), and then expires all of them, with deadlines spread over 60s.
+
+template <class Timer>
+void armRearmExpire(unsigned n, Timer& timer, size_t size) {
+  std::vector<Item> items;
+  std::vector<uint64_t> deadlines;
+  BENCHMARK_SUSPEND {
+    items.resize(size);
+    for (size_t i = 0; i < size; i++) {
+      deadlines.push_back(Random::rand64(0, 60000000));
+    }
+  }
+  uint64_t base = 0;
+  for (unsigned iter = 0; iter < n; iter++) {
+    for (size_t i = 0; i < size; i++) {
+      timer.push(Timeout<Item>(&items[i], base + deadlines[i]));
+    }
+    for (size_t i = 0; i < size; i++) {
+      timer.erase(&items[i]);
+      timer.push(Timeout<Item>(&items[i], base + deadlines[i] + 1000000));
+    }
+    base += 61000000;
+    while (timer.pop(base).data) {}
+  }
+}
+
+void timedHeap(unsigned n, size_t size) {
+  TimedHeap<Item> heap;
+  armRearmExpire(n, heap, size);
+}
+
+void timingWheel(unsigned n, size_t size) {
+  ItemWheel wheel(1000, 0);
+  armRearmExpire(n, wheel, size);
+}
+
+// sudo nice -n -20 ./accelerator/test/accelerator_base_TimingWheelBenchmark
+// ============================================================================
+// TimingWheelBenchmark.cpp                        relative  time/iter  iters/s
+// ============================================================================
+// timedHeap(10k)                                               4.93ms   202.82
+// timingWheel(10k)                                1119.58%   440.39us    2.27K
+// ----------------------------------------------------------------------------
+// timedHeap(100k)                                             62.50ms    16.00
+// timingWheel(100k)                               1027.97%     6.08ms   164.46
+// ----------------------------------------------------------------------------
+// timedHeap(1m)                                                 2.02s  494.38m
+// timingWheel(1m)                                 1024.83%   197.37ms     5.07
+// ============================================================================
+
+BENCHMARK_NAMED_PARAM(timedHeap, 10k, 10000)
+BENCHMARK_RELATIVE_NAMED_PARAM(timingWheel, 10k, 10000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(timedHeap, 100k, 100000)
+BENCHMARK_RELATIVE_NAMED_PARAM(timingWheel, 100k, 100000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(timedHeap, 1m, 1000000)
+BENCHMARK_RELATIVE_NAMED_PARAM(timingWheel, 1m, 1000000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  acc::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <gtest/gtest.h>
+
+#include "accelerator/TimingWheel.h"
+
+using namespace acc;
+
+struct Item {
+  int i;
+  TimingWheelHook<Item> hook;
+
+  explicit Item(int i_) : i(i_) {}
+};
+
+typedef TimingWheel<Item, &Item::hook> ItemWheel;
+
+TEST(TimingWheel, push_pop) {
+  uint64_t t = timestampNow();
+  ItemWheel wheel(1000, t);
+
+  Item i1(1), i2(2), i3(3), i4(4);
+  wheel.push(Timeout<Item>(&i1, t + 1));
+  wheel.push(Timeout<Item>(&i2, t + 2));
+  wheel.push(Timeout<Item>(&i3, t + 3));
+  wheel.push(Timeout<Item>(&i4, t + 4));
+  EXPECT_EQ(4, wheel.size());
+
+  auto timeoutA = wheel.pop(t + 1);
+  EXPECT_EQ(1, timeoutA.data->i);
+  EXPECT_EQ(t + 1, timeoutA.deadline);
+  auto timeoutB = wheel.pop(t + 2);
+  EXPECT_EQ(2, timeoutB.data->i);
+  auto timeoutC = wheel.pop(t + 3);
+  EXPECT_EQ(3, timeoutC.data->i);
+  auto timeoutD = wheel.pop(t + 4);
+  EXPECT_EQ(4, timeoutD.data->i);
+  auto timeoutE = wheel.pop(t + 4);
+  EXPECT_EQ(nullptr, timeoutE.data);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheel, erase_repush) {
+  uint64_t t = 0;
+  ItemWheel wheel(1000, t);
+
+  Item i1(1), i2(2);
+  wheel.push(Timeout<Item>(&i1, t + 5000));
+  wheel.push(Timeout<Item>(&i2, t + 6000));
+  wheel.erase(&i1);
+  wheel.erase(&i1);
+  EXPECT_EQ(1, wheel.size());
+
+  // re-push moves the timer
+  wheel.push(Timeout<Item>(&i2, t + 10000, true));
+  EXPECT_EQ(1, wheel.size());
+  EXPECT_EQ(nullptr, wheel.pop(t + 9999).data);
+  auto timeout = wheel.pop(t + 10000);
+  EXPECT_EQ(2, timeout.data->i);
+  EXPECT_TRUE(timeout.repeat);
+  EXPECT_EQ(nullptr, wheel.pop(t + 100000).data);
+}
+
+TEST(TimingWheel, cascade) {
+  uint64_t t = 0;
+  ItemWheel wheel(1, t);
+
+  std::vector<uint64_t> deadlines = {
+    0, 255, 256, 257, 65535, 65536, 70000, 16777216, 20000000,
+  };
+  std::vector<std::unique_ptr<Item>> items;
+  for (size_t i = 0; i < deadlines.size(); i++) {
+    items.emplace_back(new Item(i));
+    wheel.push(Timeout<Item>(items.back().get(), deadlines[i]));
+  }
+  for (size_t i = 0; i < deadlines.size(); i++) {
+    if (deadlines[i] > 0) {
+      EXPECT_EQ(nullptr, wheel.pop(deadlines[i] - 1).data);
+    }
+    auto timeout = wheel.pop(deadlines[i]);
+    ASSERT_NE(nullptr, timeout.data);
+    EXPECT_EQ(i, timeout.data->i);
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheel, destroy) {
+  uint64_t t = timestampNow();
+  std::unique_ptr<Item> item(new Item(1));
+  {
+    ItemWheel wheel(1000, t);
+    wheel.push(Timeout<Item>(item.get(), t + 1));
+    // the item goes first, the wheel must not write into it
+    item.reset();
+  }
+}
@@ -99,6 +99,23 @@ class AtomicIntrusiveLinkedList {
     return oldHead == nullptr;
   }
 
+  /**
+   * Atomically insert the chain from head to tail linked by their hooks.
+   * @return True if the list was empty before the call.
+   */
+  bool insertHead(T* head, T* tail) {
+    assert(next(tail) == nullptr);
+
+    auto oldHead = head_.load(std::memory_order_relaxed);
+    do {
+      next(tail) = oldHead;
+    } while (!head_.compare_exchange_weak(oldHead, head,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+
+    return oldHead == nullptr;
+  }
+
   /**
    * Repeatedly replaces the head with nullptr,
    * and calls func() on the removed elements in the order from tail to head.
@@ -112,6 +129,22 @@ class AtomicIntrusiveLinkedList {
     }
   }
 
+  /**
+   * Similar to sweep() but takes the list only once: func() is called in
+   * FIFO order for the elements in the list at the moment sweepOnce() is
+   * called, elements inserted meanwhile are left for the next call.
+   * @return True if any element was swept.
+   */
+  template <typename F>
+  bool sweepOnce(F&& func) {
+    auto head = head_.exchange(nullptr);
+    if (head == nullptr) {
+      return false;
+    }
+    unlinkAll(reverse(head), std::forward<F>(func));
+    return true;
+  }
+
   /**
    * Similar to sweep() but calls func() on elements in LIFO order.
    *
@@ -204,6 +237,26 @@ class AtomicLinkedList {
     return list_.insertHead(wrapper.release());
   }
 
+  /**
+   * Atomically insert [begin, end) at the head of the list, keeping their
+   * order for sweep().
+   * @return True if the list was empty before the call.
+   */
+  template <typename It>
+  bool insertHead(It begin, It end) {
+    Wrapper* first = nullptr;
+    Wrapper* last = nullptr;
+    for (; begin != end; ++begin) {
+      auto wrapper = new Wrapper(std::move(*begin));
+      wrapper->hook.next = last;
+      last = wrapper;
+      if (!first) {
+        first = wrapper;
+      }
+    }
+    return last ? list_.insertHead(last, first) : empty();
+  }
+
   /**
    * Repeatedly pops element from head,
    * and calls func() on the removed elements in the order from tail to head.
@@ -218,6 +271,19 @@ class AtomicLinkedList {
     });
   }
 
+  /**
+   * Similar to sweep() but takes the list only once, in FIFO order.
+   * @return True if any element was swept.
+   */
+  template <typename F>
+  bool sweepOnce(F&& func) {
+    return list_.sweepOnce([&](Wrapper* wrapperPtr) mutable {
+      std::unique_ptr<Wrapper> wrapper(wrapperPtr);
+
+      func(std::move(wrapper->data));
+    });
+  }
+
   /**
    * Similar to sweep() but calls func() on elements in LIFO order.
    *
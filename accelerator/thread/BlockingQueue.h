@@ -16,8 +16,13 @@
 
 #pragma once
 
+#include <functional>
+#include <mutex>
 #include <queue>
+#include <vector>
 
+#include "accelerator/Macro.h"
+#include "accelerator/thread/LifoSem.h"
 #include "accelerator/thread/MPMCQueue.h"
 #include "accelerator/thread/Semaphore.h"
 #include "accelerator/thread/Synchronized.h"
@@ -32,9 +37,42 @@ class BlockingQueue {
   virtual void add(T item) = 0;
   virtual T take() = 0;
   virtual size_t size() = 0;
+
+  // adds item unless the queue is full, item is only moved on success
+  virtual bool tryAdd(T&& item) {
+    add(std::move(item));
+    return true;
+  }
+
+  // takes an item if there is one, without waiting
+  virtual bool tryTake(T& /* item */) {
+    return false;
+  }
+
+  // takes the first item if pred holds for it, without waiting, else
+  // leaves it first; not supported (false) by default
+  virtual bool tryTakeIf(const std::function<bool(const T&)>& /* pred */,
+                         T& /* item */) {
+    return false;
+  }
+
+  // adds items until the queue is full, waking only as many consumers
+  // as needed, returns the number added, the rest are left in items
+  virtual size_t addBatch(std::vector<T>& items) {
+    size_t n = 0;
+    while (n < items.size() && tryAdd(std::move(items[n]))) {
+      n++;
+    }
+    return n;
+  }
+
+  virtual uint8_t getNumPriorities() {
+    return 1;
+  }
 };
 
-template <class T>
+// Sem is LifoSem by default, or Semaphore (sem_t)
+template <class T, class Sem = LifoSem>
 class GenericBlockingQueue : public BlockingQueue<T> {
  public:
   GenericBlockingQueue() {}
@@ -44,6 +82,38 @@ class GenericBlockingQueue : public BlockingQueue<T> {
     sem_.post();
   }
 
+  bool tryTake(T& item) override {
+    auto wlockedQueue = queue_.wlock();
+    if (wlockedQueue->empty()) {
+      return false;
+    }
+    item = std::move(wlockedQueue->front());
+    wlockedQueue->pop();
+    return true;
+  }
+
+  bool tryTakeIf(const std::function<bool(const T&)>& pred,
+                 T& item) override {
+    auto wlockedQueue = queue_.wlock();
+    if (wlockedQueue->empty() || !pred(wlockedQueue->front())) {
+      return false;
+    }
+    item = std::move(wlockedQueue->front());
+    wlockedQueue->pop();
+    return true;
+  }
+
+  size_t addBatch(std::vector<T>& items) override {
+    {
+      auto wlockedQueue = queue_.wlock();
+      for (auto& item : items) {
+        wlockedQueue->push(std::move(item));
+      }
+    }
+    sem_.post(items.size());
+    return items.size();
+  }
+
   T take() override {
     while (true) {
       {
@@ -64,26 +134,72 @@ class GenericBlockingQueue : public BlockingQueue<T> {
   }
 
  private:
-  Semaphore sem_;
+  Sem sem_;
   Synchronized<std::queue<T>> queue_;
 };
 
-template <class T>
+template <class T, class Sem = LifoSem>
 class MPMCBlockingQueue : public BlockingQueue<T> {
  public:
   // Note: The queue pre-allocates all memory for max_capacity
   explicit MPMCBlockingQueue(size_t max_capacity) : queue_(max_capacity) {}
 
   void add(T item) override {
-    if (!queue_.write(std::move(item))) {
+    if (!tryAdd(std::move(item))) {
       throw std::runtime_error("LifoSemMPMCQueue full, can't add item");
     }
+  }
+
+  bool tryAdd(T&& item) override {
+    if (UNLIKELY(frontFull()) || !queue_.write(std::move(item))) {
+      return false;
+    }
     sem_.post();
+    return true;
+  }
+
+  // leaves a surplus permit, which only costs a consumer a spurious wake
+  bool tryTake(T& item) override {
+    return takeFront(item) || queue_.readIfNotEmpty(item);
+  }
+
+  // The first item is read out to check pred, and held in front_ if pred
+  // fails, where consumers take it before the queue.
+  bool tryTakeIf(const std::function<bool(const T&)>& pred,
+                 T& item) override {
+    std::lock_guard<std::mutex> guard(frontLock_);
+    if (!hasFront_.load(std::memory_order_relaxed)) {
+      if (!queue_.readIfNotEmpty(front_)) {
+        return false;
+      }
+      if (!pred(front_)) {
+        hasFront_.store(true, std::memory_order_release);
+        // a consumer may have missed it while it was out of the queue
+        sem_.post();
+        return false;
+      }
+    } else if (!pred(front_)) {
+      return false;
+    } else {
+      hasFront_.store(false, std::memory_order_relaxed);
+    }
+    item = std::move(front_);
+    return true;
+  }
+
+  size_t addBatch(std::vector<T>& items) override {
+    size_t n = 0;
+    while (n < items.size() && !frontFull() &&
+           queue_.write(std::move(items[n]))) {
+      n++;
+    }
+    sem_.post(n);
+    return n;
   }
 
   T take() override {
     T item;
-    while (!queue_.readIfNotEmpty(item)) {
+    while (!takeFront(item) && !queue_.readIfNotEmpty(item)) {
       sem_.wait();
     }
     return item;
@@ -94,12 +210,35 @@ class MPMCBlockingQueue : public BlockingQueue<T> {
   }
 
   size_t size() override {
-    return queue_.size();
+    return queue_.size() + hasFront_.load(std::memory_order_relaxed);
   }
 
  private:
-  Semaphore sem_;
+  // the item held in front_ keeps its place in the capacity
+  bool frontFull() const {
+    return hasFront_.load(std::memory_order_relaxed) &&
+      queue_.size() + 1 >= static_cast<ssize_t>(queue_.capacity());
+  }
+
+  bool takeFront(T& item) {
+    if (LIKELY(!hasFront_.load(std::memory_order_acquire))) {
+      return false;
+    }
+    std::lock_guard<std::mutex> guard(frontLock_);
+    if (!hasFront_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    item = std::move(front_);
+    hasFront_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+  Sem sem_;
   MPMCQueue<T> queue_;
+  // the first item, read out by tryTakeIf() and left there
+  std::atomic<bool> hasFront_{false};
+  std::mutex frontLock_;
+  T front_;
 };
 
 } // namespace acc
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "accelerator/Asm.h"
+#include "accelerator/thread/Futex.h"
+
+namespace acc {
+
+/**
+ * Counting semaphore waking its waiters in LIFO order.
+ *
+ * The most recently idled thread is woken first, it is the most likely
+ * to still have a warm cache, and surplus threads stay asleep. post()
+ * is a pair of atomic operations when no thread is waiting, and wait()
+ * spins briefly before parking on a futex of its own, which post()
+ * hands the permit over to directly as a Baton does (the Baton itself
+ * is not used as it always spins 2us before blocking).
+ *
+ * Waiters may be split in lanes, such as the nodes of a ThreadTopology:
+ * post() wakes the waiters of its own lane first, and those of another
+ * lane only when its lane has none. The permits are shared by all lanes.
+ *
+ * Same post() / wait() interface as Semaphore.
+ */
+class LifoSem {
+ public:
+  explicit LifoSem(uint32_t value = 0, size_t lanes = 1)
+    : value_(value), heads_(lanes, nullptr) {}
+
+  LifoSem(const LifoSem&) = delete;
+  LifoSem& operator=(const LifoSem&) = delete;
+
+  void post() {
+    post(1);
+  }
+
+  // wakes only as many waiters as needed for n permits
+  void post(uint32_t n) {
+    post(n, 0);
+  }
+
+  // wakes the waiters of lane first
+  void post(uint32_t n, size_t lane) {
+    if (n == 0) {
+      return;
+    }
+    value_.fetch_add(n);
+    if (waiters_.load() == 0) {
+      return;
+    }
+    Waiter* woken = nullptr;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      // take the permits back to hand them to the last waiters, unless
+      // spinning threads got them first
+      size_t l;
+      while (findWaiter(lane, l) && n-- > 0 && tryWait()) {
+        Waiter* waiter = heads_[l];
+        heads_[l] = waiter->next;
+        waiter->next = woken;
+        woken = waiter;
+        waiters_--;
+      }
+    }
+    while (woken) {
+      Waiter* waiter = woken;
+      woken = waiter->next;
+      waiter->post();
+    }
+  }
+
+  bool tryWait() {
+    uint32_t value = value_.load(std::memory_order_relaxed);
+    while (value > 0) {
+      if (value_.compare_exchange_weak(value, value - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void wait(size_t lane = 0) {
+    for (int i = 0; ; i++) {
+      if (tryWait()) {
+        return;
+      }
+      if (i >= spinAttempts()) {
+        break;
+      }
+      asm_volatile_pause();
+    }
+    Waiter waiter;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      // announce before the last check, post() either leaves its permit
+      // to this check or sees the waiter; the fence keeps the relaxed
+      // load of tryWait() after the announce (store-load, as post())
+      waiters_++;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (tryWait()) {
+        waiters_--;
+        return;
+      }
+      waiter.next = heads_[lane];
+      heads_[lane] = &waiter;
+    }
+    waiter.wait();
+  }
+
+  uint32_t valueGuess() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+  uint32_t waitersGuess() const {
+    return waiters_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // about 2us as Baton, no spinning on a single cpu where the poster
+  // cannot run while we spin
+  static int spinAttempts() {
+    static const int attempts =
+      std::thread::hardware_concurrency() > 1 ? 300 : 0;
+    return attempts;
+  }
+
+  // Prerequisite: lock_ held
+  bool findWaiter(size_t lane, size_t& found) const {
+    size_t n = heads_.size();
+    for (size_t k = 0; k < n; k++) {
+      found = (lane + k) % n;
+      if (heads_[found]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  struct Waiter {
+    Futex state{0};
+    Waiter* next{nullptr};
+
+    // the waiter may return before futexWake, a spurious wake of the
+    // reused address is harmless
+    void post() {
+      state.store(1, std::memory_order_release);
+      state.futexWake(1);
+    }
+
+    void wait() {
+      while (state.load(std::memory_order_acquire) == 0) {
+        state.futexWait(0);
+      }
+    }
+  };
+
+  std::atomic<uint32_t> value_;
+  std::atomic<uint32_t> waiters_{0};
+  std::mutex lock_;
+  std::vector<Waiter*> heads_;   // by lane
+};
+
+} // namespace acc
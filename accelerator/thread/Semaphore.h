@@ -36,6 +36,12 @@ class Semaphore {
     checkUnixError(sem_post(&sem_), "sem_post");
   }
 
+  void post(unsigned int n) const {
+    while (n-- > 0) {
+      post();
+    }
+  }
+
   void wait() const {
     checkUnixError(sem_wait(&sem_), "sem_wait");
   }
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2018 Yeolar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "accelerator/thread/LifoSem.h"
+
+using namespace acc;
+
+static void waitForWaiters(const LifoSem& sem, uint32_t n) {
+  while (sem.waitersGuess() < n) {
+    std::this_thread::yield();
+  }
+}
+
+TEST(LifoSem, basic) {
+  LifoSem sem(2);
+  EXPECT_EQ(2, sem.valueGuess());
+  sem.wait();
+  EXPECT_TRUE(sem.tryWait());
+  EXPECT_FALSE(sem.tryWait());
+  sem.post(3);
+  EXPECT_EQ(3, sem.valueGuess());
+  sem.wait();
+  sem.wait();
+  sem.wait();
+  EXPECT_EQ(0, sem.valueGuess());
+}
+
+TEST(LifoSem, lifo) {
+  LifoSem sem;
+  std::atomic<int> order(0);
+  int first = 0, second = 0;
+  std::thread a([&]() { sem.wait(); first = ++order; });
+  waitForWaiters(sem, 1);
+  std::thread b([&]() { sem.wait(); second = ++order; });
+  waitForWaiters(sem, 2);
+  sem.post();
+  b.join();
+  sem.post();
+  a.join();
+  EXPECT_EQ(2, first);
+  EXPECT_EQ(1, second);
+  EXPECT_EQ(0, sem.waitersGuess());
+}
+
+TEST(LifoSem, lanes) {
+  LifoSem sem(0, 2);
+  std::atomic<int> order(0);
+  int lane0 = 0, lane1 = 0;
+  std::thread a([&]() { sem.wait(0); lane0 = ++order; });
+  waitForWaiters(sem, 1);
+  std::thread b([&]() { sem.wait(1); lane1 = ++order; });
+  waitForWaiters(sem, 2);
+  // the waiter of lane 0, though not the last
+  sem.post(1, 0);
+  a.join();
+  // lane 0 has no waiter left, falls back to lane 1
+  sem.post(1, 0);
+  b.join();
+  EXPECT_EQ(1, lane0);
+  EXPECT_EQ(2, lane1);
+}
+
+TEST(LifoSem, postBatch) {
+  LifoSem sem;
+  std::atomic<int> taken(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() { sem.wait(); taken++; });
+  }
+  waitForWaiters(sem, 4);
+  // wakes only two of the waiters
+  sem.post(2);
+  while (taken < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(2, sem.waitersGuess());
+  EXPECT_EQ(0, sem.valueGuess());
+  sem.post(3);
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(4, taken);
+  EXPECT_EQ(1, sem.valueGuess());
+}
+
+TEST(LifoSem, producerConsumer) {
+  LifoSem sem;
+  std::atomic<int> taken(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 10000; j++) {
+        sem.wait();
+        taken++;
+      }
+    });
+  }
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 10000; j++) {
+        sem.post();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(40000, taken);
+  EXPECT_EQ(0, sem.valueGuess());
+}